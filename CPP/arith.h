@@ -0,0 +1,70 @@
+#ifndef ARITH_H
+#define ARITH_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+// Integer semantics shared by the optimizer and every execution engine.
+// Values are 32-bit two's complement. +, - and * wrap around, / truncates
+// toward zero, INT_MIN / -1 wraps to INT_MIN, and dividing by zero is a
+// runtime error. Comparisons and logical operators produce 0 or 1.
+
+int32_t wrapAdd(int32_t a, int32_t b) { return static_cast<int32_t>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b)); }
+int32_t wrapSub(int32_t a, int32_t b) { return static_cast<int32_t>(static_cast<uint32_t>(a) - static_cast<uint32_t>(b)); }
+int32_t wrapMul(int32_t a, int32_t b) { return static_cast<int32_t>(static_cast<uint32_t>(a) * static_cast<uint32_t>(b)); }
+int32_t wrapNeg(int32_t a) { return static_cast<int32_t>(0u - static_cast<uint32_t>(a)); }
+
+// High 32 bits of the 64-bit product, and an arithmetic shift right; the
+// optimizer rewrites division by a constant into these
+int32_t mulHigh(int32_t a, int32_t b) {
+    return static_cast<int32_t>((static_cast<int64_t>(a) * static_cast<int64_t>(b)) >> 32);
+}
+int32_t shiftRight(int32_t a, int32_t amount) { return a >> (amount & 31); }
+
+// Caller must have ruled out b == 0
+int32_t wrapDiv(int32_t a, int32_t b) {
+    if (b == -1) return wrapNeg(a);
+    return a / b;
+}
+
+// NUMBER literals wrap modulo 2^32, so -2147483648 round-trips
+int32_t parseIntLiteral(const std::string& text) {
+    uint32_t value = 0;
+    size_t i = 0;
+    bool negative = !text.empty() && text[0] == '-';
+    if (negative) i++;
+    for (; i < text.size(); ++i) {
+        value = value * 10u + static_cast<uint32_t>(text[i] - '0');
+    }
+    return negative ? wrapNeg(static_cast<int32_t>(value)) : static_cast<int32_t>(value);
+}
+
+int32_t charLiteralValue(const std::string& text) {
+    return text.empty() ? 0 : static_cast<int32_t>(static_cast<unsigned char>(text[0]));
+}
+
+// Evaluates a BINOP or COMPARISON_OP operator. Returns false, leaving result
+// untouched, when the operation traps (division by zero).
+bool evalBinaryOp(const std::string& op, int32_t a, int32_t b, int32_t& result) {
+    switch (op[0]) {
+        case '+': result = wrapAdd(a, b); return true;
+        case '-': result = wrapSub(a, b); return true;
+        case '*': result = wrapMul(a, b); return true;
+        case '/':
+            if (b == 0) return false;
+            result = wrapDiv(a, b);
+            return true;
+        case '=': result = a == b; return true;
+        case '!': result = a != b; return true;
+        case '<': result = op.size() > 1 ? a <= b : a < b; return true;
+        case '>': result = op.size() > 1 ? a >= b : a > b; return true;
+    }
+    throw std::runtime_error("Unknown operator: " + op);
+}
+
+int32_t evalUnaryOp(const std::string& op, int32_t a) {
+    return op == "-" ? wrapNeg(a) : (a == 0);
+}
+
+#endif
@@ -0,0 +1,374 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include "parser.h" // For ASTNode
+#include "constfold.h" // For constantValue
+#include "interpreter.h" // For findMainFunction
+
+// Stack bytecode opcodes with their number of inline operands. Operands are
+// constant pool indices, slot indices or absolute jump targets. The opcodes
+// after Trap are superinstructions, produced only by fuseSuperinstructions
+// (superinstructions.h); their constants are inline values.
+#define BYTECODE_OPCODES(X) \
+    X(Const, 1)             \
+    X(LoadLocal, 1)         \
+    X(StoreLocal, 1)        \
+    X(LoadGlobal, 1)        \
+    X(StoreGlobal, 1)       \
+    X(Dup, 0)               \
+    X(Pop, 0)               \
+    X(Add, 0)               \
+    X(Sub, 0)               \
+    X(Mul, 0)               \
+    X(Div, 0)               \
+    X(Neg, 0)               \
+    X(Not, 0)               \
+    X(Eq, 0)                \
+    X(Ne, 0)                \
+    X(Lt, 0)                \
+    X(Le, 0)                \
+    X(Gt, 0)                \
+    X(Ge, 0)                \
+    X(Jump, 1)              \
+    X(JumpIfFalse, 1)       \
+    X(JumpIfTrue, 1)        \
+    X(Return, 0)            \
+    X(Trap, 0)              \
+    X(AddLocalConstStore, 3) \
+    X(BranchLocalEqConst, 3) \
+    X(BranchLocalNeConst, 3) \
+    X(BranchLocalLtConst, 3) \
+    X(BranchLocalLeConst, 3) \
+    X(BranchLocalGtConst, 3) \
+    X(BranchLocalGeConst, 3) \
+    X(StoreLocalLoadLocal, 2) \
+    X(LoadLocalConst, 2)    \
+    X(LoadLocalLoadLocal, 2)
+
+enum class Opcode : int32_t {
+#define BYTECODE_ENUM(name, operands) name,
+    BYTECODE_OPCODES(BYTECODE_ENUM)
+#undef BYTECODE_ENUM
+    Count
+};
+
+const char* opcodeName(Opcode op) {
+    static const char* const names[] = {
+#define BYTECODE_NAME(name, operands) #name,
+        BYTECODE_OPCODES(BYTECODE_NAME)
+#undef BYTECODE_NAME
+    };
+    return names[static_cast<int32_t>(op)];
+}
+
+int opcodeOperands(Opcode op) {
+    static const int operands[] = {
+#define BYTECODE_OPERANDS(name, count) count,
+        BYTECODE_OPCODES(BYTECODE_OPERANDS)
+#undef BYTECODE_OPERANDS
+    };
+    return operands[static_cast<int32_t>(op)];
+}
+
+// Index of the operand holding an absolute jump target, or -1
+int opcodeJumpOperand(Opcode op) {
+    switch (op) {
+        case Opcode::Jump:
+        case Opcode::JumpIfFalse:
+        case Opcode::JumpIfTrue:
+            return 0;
+        case Opcode::BranchLocalEqConst:
+        case Opcode::BranchLocalNeConst:
+        case Opcode::BranchLocalLtConst:
+        case Opcode::BranchLocalLeConst:
+        case Opcode::BranchLocalGtConst:
+        case Opcode::BranchLocalGeConst:
+            return 2;
+        default:
+            return -1;
+    }
+}
+
+// A compiled program: the global initializers followed by main's body as one
+// code stream starting at index 0, which runs until a Return
+struct BytecodeModule {
+    std::vector<int32_t> code;
+    std::vector<int32_t> constants;
+    int32_t globalCount = 0;
+    int32_t frameSize = 0;
+    int32_t maxStack = 0; // Deepest the operand stack gets
+};
+
+// Compiles a resolved PROGRAM to stack bytecode. Conditions compile to jumps,
+// so && and || only materialize 0/1 when their value is used, and loops test
+// their condition at the bottom.
+class BytecodeCompiler {
+private:
+    // A jump target; jumps emitted before it is bound are patched by bind()
+    struct Label {
+        int32_t position = -1;
+        std::vector<size_t> patches;
+    };
+
+    BytecodeModule module;
+    std::unordered_map<int32_t, int32_t> constantIndex;
+    int32_t depth = 0;
+
+    void adjust(int32_t delta) {
+        depth += delta;
+        if (depth > module.maxStack) module.maxStack = depth;
+    }
+
+    void emit(Opcode op, int32_t delta) {
+        module.code.push_back(static_cast<int32_t>(op));
+        adjust(delta);
+    }
+
+    void emit(Opcode op, int32_t operand, int32_t delta) {
+        emit(op, delta);
+        module.code.push_back(operand);
+    }
+
+    void emitConstant(int32_t value) {
+        auto found = constantIndex.find(value);
+        if (found == constantIndex.end()) {
+            found = constantIndex.emplace(value, static_cast<int32_t>(module.constants.size())).first;
+            module.constants.push_back(value);
+        }
+        emit(Opcode::Const, found->second, 1);
+    }
+
+    void emitJump(Opcode op, Label& label) {
+        emit(op, op == Opcode::Jump ? 0 : -1);
+        if (label.position < 0) {
+            label.patches.push_back(module.code.size());
+        }
+        module.code.push_back(label.position);
+    }
+
+    void bind(Label& label) {
+        label.position = static_cast<int32_t>(module.code.size());
+        for (size_t patch : label.patches) {
+            module.code[patch] = label.position;
+        }
+        label.patches.clear();
+    }
+
+    void emitStore(const ASTNode* target) {
+        emit(target->isGlobal ? Opcode::StoreGlobal : Opcode::StoreLocal, target->slot, -1);
+    }
+
+    static Opcode binaryOpcode(const std::string& op) {
+        if (op == "+") return Opcode::Add;
+        if (op == "-") return Opcode::Sub;
+        if (op == "*") return Opcode::Mul;
+        if (op == "/") return Opcode::Div;
+        if (op == "==") return Opcode::Eq;
+        if (op == "!=") return Opcode::Ne;
+        if (op == "<") return Opcode::Lt;
+        if (op == "<=") return Opcode::Le;
+        if (op == ">") return Opcode::Gt;
+        if (op == ">=") return Opcode::Ge;
+        throw std::runtime_error("Unknown operator: " + op);
+    }
+
+    // Jumps to target when the condition's truth equals jumpWhen; otherwise
+    // falls through. Leaves the stack as it found it.
+    void compileBranch(ASTNode* node, bool jumpWhen, Label& target) {
+        int32_t value;
+        if (constantValue(node, value)) {
+            if ((value != 0) == jumpWhen) emitJump(Opcode::Jump, target);
+            return;
+        }
+        if (node->kind == NodeKind::UnaryOp && node->value == "!") {
+            compileBranch(node->children[0], !jumpWhen, target);
+            return;
+        }
+        if (node->kind == NodeKind::LogicalOp) {
+            // && jumps early on false, || on true
+            bool decidesOn = node->value != "&&";
+            if (jumpWhen == decidesOn) {
+                compileBranch(node->children[0], jumpWhen, target);
+                compileBranch(node->children[1], jumpWhen, target);
+            } else {
+                Label skip;
+                compileBranch(node->children[0], decidesOn, skip);
+                compileBranch(node->children[1], jumpWhen, target);
+                bind(skip);
+            }
+            return;
+        }
+        compileExpression(node, true);
+        emitJump(jumpWhen ? Opcode::JumpIfTrue : Opcode::JumpIfFalse, target);
+    }
+
+    // Compiles an expression, leaving its value on the stack only if wanted
+    void compileExpression(ASTNode* node, bool wantValue) {
+        switch (node->kind) {
+            case NodeKind::Assignment:
+                compileExpression(node->children[0], true);
+                if (wantValue) emit(Opcode::Dup, 1);
+                emitStore(node);
+                return;
+
+            case NodeKind::Number:
+            case NodeKind::Char:
+                emitConstant(node->literal);
+                break;
+
+            case NodeKind::Identifier:
+                emit(node->isGlobal ? Opcode::LoadGlobal : Opcode::LoadLocal, node->slot, 1);
+                break;
+
+            case NodeKind::BinOp:
+            case NodeKind::ComparisonOp:
+                compileExpression(node->children[0], true);
+                compileExpression(node->children[1], true);
+                emit(binaryOpcode(node->value), -1);
+                break;
+
+            case NodeKind::UnaryOp:
+                compileExpression(node->children[0], true);
+                emit(node->value == "-" ? Opcode::Neg : Opcode::Not, 0);
+                break;
+
+            case NodeKind::LogicalOp: {
+                Label isFalse, done;
+                compileBranch(node, false, isFalse);
+                emitConstant(1);
+                emitJump(Opcode::Jump, done);
+                adjust(-1);
+                bind(isFalse);
+                emitConstant(0);
+                bind(done);
+                break;
+            }
+
+            default:
+                // STRING values only fail once they are actually evaluated
+                emit(Opcode::Trap, 1);
+                break;
+        }
+        if (!wantValue) emit(Opcode::Pop, -1);
+    }
+
+    void compileStatement(ASTNode* node) {
+        switch (node->kind) {
+            case NodeKind::Block:
+                for (ASTNode* child : node->children) {
+                    compileStatement(child);
+                }
+                break;
+
+            case NodeKind::DeclarationInt:
+            case NodeKind::DeclarationChar:
+                // Uninitialized variables start out as zero on every entry
+                if (node->children.empty()) {
+                    emitConstant(0);
+                } else {
+                    compileExpression(node->children[0], true);
+                }
+                emitStore(node);
+                break;
+
+            case NodeKind::If: {
+                Label elseBranch, done;
+                compileBranch(node->children[0], false, elseBranch);
+                compileStatement(node->children[1]);
+                if (node->children.size() > 2) {
+                    emitJump(Opcode::Jump, done);
+                    bind(elseBranch);
+                    compileStatement(node->children[2]);
+                } else {
+                    bind(elseBranch);
+                }
+                bind(done);
+                break;
+            }
+
+            case NodeKind::While: {
+                Label body, condition;
+                emitJump(Opcode::Jump, condition);
+                bind(body);
+                compileStatement(node->children[1]);
+                bind(condition);
+                compileBranch(node->children[0], true, body);
+                break;
+            }
+
+            case NodeKind::For: {
+                Label body, condition;
+                compileStatement(node->children[0]);
+                emitJump(Opcode::Jump, condition);
+                bind(body);
+                compileStatement(node->children[3]);
+                compileExpression(node->children[2], false);
+                bind(condition);
+                compileBranch(node->children[1], true, body);
+                break;
+            }
+
+            case NodeKind::Return:
+                if (node->children.empty()) {
+                    emitConstant(0);
+                } else {
+                    compileExpression(node->children[0], true);
+                }
+                emit(Opcode::Return, -1);
+                break;
+
+            default:
+                compileExpression(node, false);
+                break;
+        }
+    }
+
+public:
+    BytecodeModule compile(ASTNode* program) {
+        ASTNode* mainFunction = findMainFunction(program);
+        module.globalCount = program->frameSize;
+        module.frameSize = mainFunction->frameSize;
+        for (ASTNode* child : program->children) {
+            if (child->kind == NodeKind::DeclarationInt || child->kind == NodeKind::DeclarationChar) {
+                compileStatement(child);
+            }
+        }
+        if (mainFunction->children.size() > 1) {
+            compileStatement(mainFunction->children[1]);
+        }
+        // Falling off the end of main returns 0
+        emitConstant(0);
+        emit(Opcode::Return, -1);
+        return module;
+    }
+};
+
+BytecodeModule compileBytecode(ASTNode* program) {
+    BytecodeCompiler compiler;
+    return compiler.compile(program);
+}
+
+// Prints one instruction per line as "index: Opcode operand"
+void disassemble(const BytecodeModule& module, std::ostream& out) {
+    for (size_t pc = 0; pc < module.code.size();) {
+        Opcode op = static_cast<Opcode>(module.code[pc]);
+        out << "  " << std::setw(5) << std::right << pc << ": " << opcodeName(op);
+        for (int i = 0; i < opcodeOperands(op); ++i) {
+            out << " " << module.code[pc + 1 + i];
+        }
+        if (op == Opcode::Const) {
+            out << " (" << module.constants[module.code[pc + 1]] << ")";
+        }
+        out << "\n";
+        pc += 1 + opcodeOperands(op);
+    }
+    out << std::left;
+}
+
+#endif
@@ -0,0 +1,371 @@
+#ifndef CGEN_H
+#define CGEN_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "parser.h" // For ASTNode
+#include "interpreter.h" // For findMainFunction
+#include "process.h"
+
+// Helpers every generated file starts with. Arithmetic goes through
+// unsigned so it wraps like arith.h instead of being undefined; the casts
+// back to int32_t rely on two's complement, as every C compiler we target
+// provides. A trap prints the interpreter's message and then dies by the
+// signal process.h maps back to it (kDivideByZeroSignal, kStringValueSignal).
+const char* const kCPrelude =
+    "#include <signal.h>\n"
+    "#include <stdint.h>\n"
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "\n"
+    "static void clp_trap(const char* message, int sig) {\n"
+    "    fprintf(stderr, \"Runtime Error: %s\\n\", message);\n"
+    "    signal(sig, SIG_DFL);\n"
+    "    raise(sig);\n"
+    "    exit(1);\n"
+    "}\n"
+    "\n"
+    "static inline int32_t clp_add(int32_t a, int32_t b) { return (int32_t)((uint32_t)a + (uint32_t)b); }\n"
+    "static inline int32_t clp_sub(int32_t a, int32_t b) { return (int32_t)((uint32_t)a - (uint32_t)b); }\n"
+    "static inline int32_t clp_mul(int32_t a, int32_t b) { return (int32_t)((uint32_t)a * (uint32_t)b); }\n"
+    "static inline int32_t clp_neg(int32_t a) { return (int32_t)(0u - (uint32_t)a); }\n"
+    "\n"
+    "static inline int32_t clp_div(int32_t a, int32_t b) {\n"
+    "    if (b == 0) clp_trap(\"Division by zero\", SIGFPE);\n"
+    "    return b == -1 ? clp_neg(a) : a / b;\n"
+    "}\n"
+    "\n"
+    "static int32_t clp_string_value(void) {\n"
+    "    clp_trap(\"String values are not supported at runtime\", SIGABRT);\n"
+    "    return 0;\n"
+    "}\n";
+
+// Translates a resolved PROGRAM into one C translation unit. Each FUNCTION
+// becomes a C function whose frame slots are C locals, globals become file
+// scope variables, and C's main runs the global initializers before calling
+// the last main, so an optimizing C compiler sees the whole program.
+class CGenerator {
+private:
+    std::ostringstream out;  // The translation unit
+    std::ostringstream code; // Statements of the function being generated
+    int indent = 0;
+    int tempCount = 0;                   // Temporaries used by the current function
+    std::vector<std::string> localNames; // By slot, for the current function
+    std::vector<std::string> globalNames;
+
+    void line(const std::string& text) {
+        code << std::string(4 * indent, ' ') << text << "\n";
+    }
+
+    static std::string mangle(char prefix, int slot, const std::string& name) {
+        return std::string(1, prefix) + std::to_string(slot) + "_" + name;
+    }
+
+    // Collects a name for every slot of the kind (local or global) wanted
+    static void nameSlots(ASTNode* node, bool global, std::vector<std::string>& names) {
+        if (!node) return;
+        if (node->slot >= 0 && node->isGlobal == global && static_cast<size_t>(node->slot) < names.size() &&
+            names[node->slot].empty()) {
+            names[node->slot] = mangle(global ? 'g' : 'l', node->slot, node->value);
+        }
+        for (ASTNode* child : node->children) nameSlots(child, global, names);
+    }
+
+    static bool hasAssignment(ASTNode* node) {
+        if (!node) return false;
+        if (node->kind == NodeKind::Assignment) return true;
+        for (ASTNode* child : node->children) {
+            if (hasAssignment(child)) return true;
+        }
+        return false;
+    }
+
+    const std::string& variable(ASTNode* node) const {
+        if (node->slot < 0) {
+            throw std::runtime_error("Unresolved variable: " + node->value);
+        }
+        return node->isGlobal ? globalNames.at(node->slot) : localNames.at(node->slot);
+    }
+
+    static std::string literal(int32_t value) {
+        // -2147483648 is not a C literal; it negates an unsigned 2147483648
+        if (value == INT32_MIN) return "(-2147483647 - 1)";
+        return std::to_string(value);
+    }
+
+    // Drops the parentheses around a whole expression, for conditions
+    static std::string unparenthesized(const std::string& text) {
+        if (text.size() < 2 || text.front() != '(' || text.back() != ')') return text;
+        int depth = 0;
+        for (size_t i = 0; i + 1 < text.size(); ++i) {
+            depth += text[i] == '(' ? 1 : text[i] == ')' ? -1 : 0;
+            if (depth == 0) return text; // The first parenthesis closes early
+        }
+        return text.substr(1, text.size() - 2);
+    }
+
+    std::string condition(ASTNode* node) { return unparenthesized(expression(node)); }
+
+    // Applies a binary operator to two already generated operands
+    static std::string binary(const std::string& op, const std::string& left, const std::string& right) {
+        switch (op[0]) {
+            case '+': return "clp_add(" + left + ", " + right + ")";
+            case '-': return "clp_sub(" + left + ", " + right + ")";
+            case '*': return "clp_mul(" + left + ", " + right + ")";
+            case '/': return "clp_div(" + left + ", " + right + ")";
+        }
+        return "(" + left + " " + op + " " + right + ")";
+    }
+
+    std::string expression(ASTNode* node) {
+        switch (node->kind) {
+            case NodeKind::Number:
+            case NodeKind::Char:
+                return literal(node->literal);
+
+            case NodeKind::String:
+                return "clp_string_value()";
+
+            case NodeKind::Identifier:
+                return variable(node);
+
+            case NodeKind::Assignment:
+                return "(" + variable(node) + " = " + expression(node->children[0]) + ")";
+
+            case NodeKind::UnaryOp: {
+                std::string operand = expression(node->children[0]);
+                return node->value == "-" ? "clp_neg(" + operand + ")" : "(" + operand + " == 0)";
+            }
+
+            case NodeKind::LogicalOp:
+                return "(" + expression(node->children[0]) + " " + node->value + " " +
+                       expression(node->children[1]) + ")";
+
+            case NodeKind::BinOp:
+            case NodeKind::ComparisonOp: {
+                std::string left = expression(node->children[0]);
+                std::string right = expression(node->children[1]);
+                if (!hasAssignment(node->children[0]) && !hasAssignment(node->children[1])) {
+                    return binary(node->value, left, right);
+                }
+                // C leaves operand order unspecified, but an assignment on
+                // either side must happen in source order; the comma
+                // operator sequences the operands through temporaries
+                std::string a = "t" + std::to_string(tempCount++);
+                std::string b = "t" + std::to_string(tempCount++);
+                return "(" + a + " = " + left + ", " + b + " = " + right + ", " + binary(node->value, a, b) + ")";
+            }
+
+            default:
+                return "0";
+        }
+    }
+
+    // A statement that only computes a value, such as a declaration or an
+    // assignment, written without a trailing semicolon (for FOR headers)
+    std::string simpleStatement(ASTNode* node) {
+        switch (node->kind) {
+            case NodeKind::DeclarationInt:
+            case NodeKind::DeclarationChar:
+                // Uninitialized variables start out as zero on every entry
+                return variable(node) + " = " + (node->children.empty() ? "0" : expression(node->children[0]));
+            case NodeKind::Assignment:
+                return variable(node) + " = " + expression(node->children[0]);
+            default:
+                return "(void)" + expression(node);
+        }
+    }
+
+    void statement(ASTNode* node) {
+        switch (node->kind) {
+            case NodeKind::Block:
+                for (ASTNode* child : node->children) {
+                    statement(child);
+                }
+                break;
+
+            case NodeKind::If:
+                line("if (" + condition(node->children[0]) + ") {");
+                body(node->children[1]);
+                if (node->children.size() > 2) {
+                    line("} else {");
+                    body(node->children[2]);
+                }
+                line("}");
+                break;
+
+            case NodeKind::While:
+                line("while (" + condition(node->children[0]) + ") {");
+                body(node->children[1]);
+                line("}");
+                break;
+
+            case NodeKind::For:
+                line("for (" + simpleStatement(node->children[0]) + "; " + condition(node->children[1]) + "; " +
+                     simpleStatement(node->children[2]) + ") {");
+                body(node->children[3]);
+                line("}");
+                break;
+
+            case NodeKind::Return:
+                line("return " + (node->children.empty() ? std::string("0") : expression(node->children[0])) + ";");
+                break;
+
+            case NodeKind::Include:
+            case NodeKind::Unknown:
+                break;
+
+            default:
+                line(simpleStatement(node) + ";");
+                break;
+        }
+    }
+
+    void body(ASTNode* node) {
+        indent++;
+        statement(node);
+        indent--;
+    }
+
+    void function(ASTNode* node, const std::string& name) {
+        localNames.assign(node->frameSize, "");
+        ASTNode* functionBody = node->children.size() > 1 ? node->children[1] : nullptr;
+        nameSlots(functionBody, false, localNames);
+        for (size_t slot = 0; slot < localNames.size(); ++slot) {
+            if (localNames[slot].empty()) localNames[slot] = mangle('l', static_cast<int>(slot), "unused");
+        }
+        beginFunction();
+        if (functionBody) statement(functionBody);
+        bool returns = functionBody && !functionBody->children.empty() &&
+                       functionBody->children.back()->kind == NodeKind::Return;
+        if (!returns) line("return 0;"); // Falling off the end returns 0
+
+        out << "static int32_t " << name << "(void) {\n";
+        for (const std::string& local : localNames) {
+            out << "    int32_t " << local << " = 0;\n";
+        }
+        endFunction();
+        out << "\n";
+    }
+
+    void beginFunction() {
+        code.str("");
+        indent = 1;
+        tempCount = 0;
+    }
+
+    // Declares the temporaries, which are only known once the statements
+    // are generated, and appends the statements
+    void endFunction() {
+        for (int i = 0; i < tempCount; ++i) {
+            out << "    int32_t t" << i << ";\n";
+        }
+        out << code.str() << "}\n";
+    }
+
+public:
+    std::string generate(ASTNode* program) {
+        ASTNode* mainFunction = findMainFunction(program);
+        out << kCPrelude << "\n";
+
+        globalNames.assign(program->frameSize, "");
+        for (ASTNode* child : program->children) {
+            if (child->kind == NodeKind::DeclarationInt || child->kind == NodeKind::DeclarationChar) {
+                nameSlots(child, true, globalNames);
+            }
+        }
+        for (size_t slot = 0; slot < globalNames.size(); ++slot) {
+            if (globalNames[slot].empty()) globalNames[slot] = mangle('g', static_cast<int>(slot), "unused");
+            out << "static int32_t " << globalNames[slot] << ";\n";
+        }
+        if (!globalNames.empty()) out << "\n";
+
+        // Functions are numbered because a name may be defined more than once
+        std::string mainName;
+        int index = 0;
+        for (ASTNode* child : program->children) {
+            if (child->kind != NodeKind::Function) continue;
+            std::string name = "f" + std::to_string(index++) + "_" + child->value;
+            if (child == mainFunction) mainName = name;
+            function(child, name);
+        }
+
+        localNames.clear();
+        beginFunction();
+        for (ASTNode* child : program->children) {
+            if (child->kind == NodeKind::DeclarationInt || child->kind == NodeKind::DeclarationChar) {
+                statement(child);
+            }
+        }
+        line("return (int)" + mainName + "();");
+        out << "int main(void) {\n";
+        endFunction();
+        return out.str();
+    }
+};
+
+// C source for a resolved PROGRAM
+std::string generateC(ASTNode* program) {
+    CGenerator generator;
+    return generator.generate(program);
+}
+
+// Compiles C source into an executable with the system C compiler ($CC,
+// or cc) at optimization level `optimization` (0-3 or s)
+void compileCExecutable(const std::string& source, const std::string& executable, const std::string& optimization) {
+    char pattern[] = "/tmp/clp-XXXXXX";
+    if (!mkdtemp(pattern)) {
+        throw std::runtime_error("Could not create a build directory");
+    }
+    std::filesystem::path directory = pattern;
+    std::string sourceFile = (directory / "program.c").string();
+    int status = -1;
+    try {
+        std::ofstream file(sourceFile);
+        file << source;
+        file.close();
+        if (!file) {
+            throw std::runtime_error("Could not write C source: " + sourceFile);
+        }
+        const char* compiler = std::getenv("CC");
+        status = runProcess({compiler && *compiler ? compiler : "cc", "-std=c99", "-O" + optimization, "-o",
+                             executable, sourceFile});
+    } catch (...) {
+        std::filesystem::remove_all(directory);
+        throw;
+    }
+    std::filesystem::remove_all(directory);
+    if (status != 0) {
+        throw std::runtime_error("C compiler failed");
+    }
+}
+
+// Builds the program with the C compiler in a scratch directory, runs it
+// and returns its exit status, like runNative
+int32_t runC(ASTNode* program, const std::string& optimization) {
+    char pattern[] = "/tmp/clp-XXXXXX";
+    if (!mkdtemp(pattern)) {
+        throw std::runtime_error("Could not create a build directory");
+    }
+    std::filesystem::path directory = pattern;
+    std::string executable = (directory / "program").string();
+    int status = -1;
+    try {
+        compileCExecutable(generateC(program), executable, optimization);
+        status = runCompiledProgram(executable, "Compiled program");
+    } catch (...) {
+        std::filesystem::remove_all(directory);
+        throw;
+    }
+    std::filesystem::remove_all(directory);
+    return status;
+}
+
+#endif
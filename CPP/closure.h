@@ -0,0 +1,255 @@
+#ifndef CLOSURE_H
+#define CLOSURE_H
+
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "parser.h" // For ASTNode
+#include "constfold.h" // For constantValue
+#include "interpreter.h" // For findMainFunction
+#include "arith.h"
+
+struct AddOp { static int32_t apply(int32_t a, int32_t b) { return wrapAdd(a, b); } };
+struct SubOp { static int32_t apply(int32_t a, int32_t b) { return wrapSub(a, b); } };
+struct MulOp { static int32_t apply(int32_t a, int32_t b) { return wrapMul(a, b); } };
+struct DivOp {
+    static int32_t apply(int32_t a, int32_t b) {
+        if (b == 0) throw std::runtime_error("Division by zero");
+        return wrapDiv(a, b);
+    }
+};
+struct EqOp { static int32_t apply(int32_t a, int32_t b) { return a == b; } };
+struct NeOp { static int32_t apply(int32_t a, int32_t b) { return a != b; } };
+struct LtOp { static int32_t apply(int32_t a, int32_t b) { return a < b; } };
+struct LeOp { static int32_t apply(int32_t a, int32_t b) { return a <= b; } };
+struct GtOp { static int32_t apply(int32_t a, int32_t b) { return a > b; } };
+struct GeOp { static int32_t apply(int32_t a, int32_t b) { return a >= b; } };
+
+// Converts the resolved AST into a tree of closures once, then runs it.
+// Variables are bound to their storage when a closure is built, and common
+// leaf shapes (variable op constant, variable op variable) get their own
+// closures, so running the program does no node-kind dispatch at all.
+// Statements return true once a RETURN has run.
+class ClosureProgram {
+public:
+    using Expr = std::function<int32_t()>;
+    using Stmt = std::function<bool()>;
+
+private:
+    // Closures point into these, so they are sized once before compiling
+    std::vector<int32_t> globals;
+    std::vector<int32_t> frame;
+    int32_t returnValue = 0;
+    std::vector<Stmt> initializers;
+    Stmt body;
+
+    int32_t* variable(const ASTNode* node) {
+        return node->isGlobal ? &globals[node->slot] : &frame[node->slot];
+    }
+
+    int32_t* variableRead(const ASTNode* node) {
+        return node->kind == NodeKind::Identifier ? variable(node) : nullptr;
+    }
+
+    template <typename Op>
+    Expr binary(ASTNode* left, ASTNode* right) {
+        int32_t* a = variableRead(left);
+        int32_t* b = variableRead(right);
+        int32_t constant;
+        if (a && constantValue(right, constant)) {
+            return [a, constant] { return Op::apply(*a, constant); };
+        }
+        if (a && b) {
+            return [a, b] { return Op::apply(*a, *b); };
+        }
+        Expr leftExpr = compileExpression(left);
+        if (constantValue(right, constant)) {
+            return [leftExpr, constant] { return Op::apply(leftExpr(), constant); };
+        }
+        Expr rightExpr = compileExpression(right);
+        return [leftExpr, rightExpr] {
+            int32_t value = leftExpr(); // Left operand first
+            return Op::apply(value, rightExpr());
+        };
+    }
+
+    Expr binary(const std::string& op, ASTNode* left, ASTNode* right) {
+        if (op == "+") return binary<AddOp>(left, right);
+        if (op == "-") return binary<SubOp>(left, right);
+        if (op == "*") return binary<MulOp>(left, right);
+        if (op == "/") return binary<DivOp>(left, right);
+        if (op == "==") return binary<EqOp>(left, right);
+        if (op == "!=") return binary<NeOp>(left, right);
+        if (op == "<") return binary<LtOp>(left, right);
+        if (op == "<=") return binary<LeOp>(left, right);
+        if (op == ">") return binary<GtOp>(left, right);
+        if (op == ">=") return binary<GeOp>(left, right);
+        throw std::runtime_error("Unknown operator: " + op);
+    }
+
+    Expr compileExpression(ASTNode* node) {
+        switch (node->kind) {
+            case NodeKind::Number:
+            case NodeKind::Char: {
+                int32_t value = node->literal;
+                return [value] { return value; };
+            }
+
+            case NodeKind::Identifier: {
+                int32_t* storage = variable(node);
+                return [storage] { return *storage; };
+            }
+
+            case NodeKind::Assignment: {
+                int32_t* storage = variable(node);
+                Expr value = compileExpression(node->children[0]);
+                return [storage, value] { return *storage = value(); };
+            }
+
+            case NodeKind::BinOp:
+            case NodeKind::ComparisonOp:
+                return binary(node->value, node->children[0], node->children[1]);
+
+            case NodeKind::UnaryOp: {
+                Expr operand = compileExpression(node->children[0]);
+                if (node->value == "-") {
+                    return [operand] { return wrapNeg(operand()); };
+                }
+                return [operand] { return static_cast<int32_t>(operand() == 0); };
+            }
+
+            case NodeKind::LogicalOp: {
+                Expr left = compileExpression(node->children[0]);
+                Expr right = compileExpression(node->children[1]);
+                if (node->value == "&&") {
+                    return [left, right] { return static_cast<int32_t>(left() != 0 && right() != 0); };
+                }
+                return [left, right] { return static_cast<int32_t>(left() != 0 || right() != 0); };
+            }
+
+            default:
+                // STRING values only fail once they are actually evaluated
+                return []() -> int32_t { throw std::runtime_error("String values are not supported at runtime"); };
+        }
+    }
+
+    Stmt compileStatement(ASTNode* node) {
+        switch (node->kind) {
+            case NodeKind::Block: {
+                std::vector<Stmt> statements;
+                for (ASTNode* child : node->children) {
+                    statements.push_back(compileStatement(child));
+                }
+                return [statements] {
+                    for (const Stmt& statement : statements) {
+                        if (statement()) return true;
+                    }
+                    return false;
+                };
+            }
+
+            case NodeKind::DeclarationInt:
+            case NodeKind::DeclarationChar: {
+                // Uninitialized variables start out as zero on every entry
+                int32_t* storage = variable(node);
+                if (node->children.empty()) {
+                    return [storage] { *storage = 0; return false; };
+                }
+                Expr value = compileExpression(node->children[0]);
+                return [storage, value] { *storage = value(); return false; };
+            }
+
+            case NodeKind::If: {
+                Expr condition = compileExpression(node->children[0]);
+                Stmt thenBranch = compileStatement(node->children[1]);
+                if (node->children.size() < 3) {
+                    return [condition, thenBranch] { return condition() != 0 && thenBranch(); };
+                }
+                Stmt elseBranch = compileStatement(node->children[2]);
+                return [condition, thenBranch, elseBranch] {
+                    return condition() != 0 ? thenBranch() : elseBranch();
+                };
+            }
+
+            case NodeKind::While: {
+                Expr condition = compileExpression(node->children[0]);
+                Stmt loopBody = compileStatement(node->children[1]);
+                return [condition, loopBody] {
+                    while (condition() != 0) {
+                        if (loopBody()) return true;
+                    }
+                    return false;
+                };
+            }
+
+            case NodeKind::For: {
+                Stmt init = compileStatement(node->children[0]);
+                Expr condition = compileExpression(node->children[1]);
+                Expr update = compileExpression(node->children[2]);
+                Stmt loopBody = compileStatement(node->children[3]);
+                return [init, condition, update, loopBody] {
+                    for (init(); condition() != 0; update()) {
+                        if (loopBody()) return true;
+                    }
+                    return false;
+                };
+            }
+
+            case NodeKind::Return: {
+                int32_t* result = &returnValue;
+                if (node->children.empty()) {
+                    return [result] { *result = 0; return true; };
+                }
+                Expr value = compileExpression(node->children[0]);
+                return [result, value] { *result = value(); return true; };
+            }
+
+            default: {
+                Expr expression = compileExpression(node);
+                return [expression] { expression(); return false; };
+            }
+        }
+    }
+
+public:
+    ClosureProgram() = default;
+    ClosureProgram(const ClosureProgram&) = delete;
+    ClosureProgram& operator=(const ClosureProgram&) = delete;
+
+    void compile(ASTNode* program) {
+        ASTNode* mainFunction = findMainFunction(program);
+        globals.assign(program->frameSize, 0);
+        frame.assign(mainFunction->frameSize, 0);
+        for (ASTNode* child : program->children) {
+            if (child->kind == NodeKind::DeclarationInt || child->kind == NodeKind::DeclarationChar) {
+                initializers.push_back(compileStatement(child));
+            }
+        }
+        if (mainFunction->children.size() > 1) {
+            body = compileStatement(mainFunction->children[1]);
+        }
+    }
+
+    // Runs the global initializers, then main; returns main's exit code
+    int32_t run() {
+        returnValue = 0;
+        for (const Stmt& initializer : initializers) {
+            initializer();
+        }
+        if (body && !body()) {
+            returnValue = 0; // Fell off the end of main
+        }
+        return returnValue;
+    }
+};
+
+// Compiles a resolved PROGRAM to closures, runs it and returns main's exit code
+int32_t runClosures(ASTNode* program) {
+    ClosureProgram closures;
+    closures.compile(program);
+    return closures.run();
+}
+
+#endif
@@ -0,0 +1,314 @@
+#ifndef CONSTFOLD_H
+#define CONSTFOLD_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "parser.h" // For ASTNode
+#include "visitor.h"
+#include "arith.h"
+
+// Known constant values of int slots at a program point
+class ConstantEnv {
+private:
+    std::vector<char> known;
+    std::vector<int32_t> values;
+
+public:
+    ConstantEnv(size_t slots = 0) : known(slots, 0), values(slots, 0) {}
+
+    bool get(int slot, int32_t& value) const {
+        if (!known[slot]) return false;
+        value = values[slot];
+        return true;
+    }
+
+    void set(int slot, int32_t value) {
+        known[slot] = 1;
+        values[slot] = value;
+    }
+
+    void kill(int slot) { known[slot] = 0; }
+
+    // Keeps only facts that hold in both environments
+    void merge(const ConstantEnv& other) {
+        for (size_t i = 0; i < known.size(); ++i) {
+            if (known[i] && (!other.known[i] || other.values[i] != values[i])) {
+                known[i] = 0;
+            }
+        }
+    }
+};
+
+// Collects the local slots written anywhere in a subtree
+class AssignedSlots : public ASTVisitor<AssignedSlots> {
+public:
+    std::vector<int> slots;
+
+    void visitAssignment(ASTNode* node) {
+        if (!node->isGlobal) slots.push_back(node->slot);
+        visitChildren(node);
+    }
+
+    void visitDeclarationInt(ASTNode* node) {
+        if (!node->isGlobal) slots.push_back(node->slot);
+        visitChildren(node);
+    }
+};
+
+struct FoldStats {
+    int folded = 0;      // Operator nodes replaced by their value
+    int propagated = 0;  // Variable reads replaced by a known constant
+};
+
+// Whether the node is a literal with a compile-time int value
+bool constantValue(const ASTNode* node, int32_t& value) {
+    if (node->kind == NodeKind::Number || node->kind == NodeKind::Char) {
+        value = node->literal;
+        return true;
+    }
+    return false;
+}
+
+// Folds operator subtrees whose operands are constants and propagates int
+// constants through straight-line code. Facts survive an IF when both branches
+// agree; slots written anywhere in a loop are forgotten before the loop.
+// Division by zero is left in place so it still fails at runtime.
+class ConstantFolder {
+private:
+    ConstantEnv env;
+    ConstantEnv globalEnv;    // Only consulted while folding global initializers
+    bool inGlobalInitializer = false;
+
+    ASTNode* makeNumber(int32_t value) {
+        return new ASTNode("NUMBER", std::to_string(value));
+    }
+
+    // Replaces parent->children[index] with its folded form
+    void foldChild(ASTNode* parent, size_t index) {
+        ASTNode* original = parent->children[index];
+        ASTNode* folded = foldExpression(original);
+        if (folded != original) {
+            parent->children[index] = folded;
+            releaseNode(original);
+        }
+    }
+
+    // Folds a shared node on a private copy, since the result depends on the
+    // constants known at this use. The copy is dropped if nothing changed.
+    ASTNode* foldShared(ASTNode* node) {
+        ASTNode* copy = new ASTNode(node->type, node->value);
+        copy->children = node->children;
+        copy->slot = node->slot;
+        copy->isGlobal = node->isGlobal;
+
+        ASTNode* folded = foldExpression(copy);
+        if (folded == copy && copy->children == node->children) {
+            delete copy; // Its children are all shared and stay alive
+            return node;
+        }
+        if (folded != copy) {
+            delete copy;
+        }
+        return folded;
+    }
+
+    void killAssignedIn(ASTNode* node) {
+        AssignedSlots assigned;
+        assigned.visit(node);
+        for (int slot : assigned.slots) {
+            env.kill(slot);
+        }
+    }
+
+    void recordStore(ASTNode* target, ASTNode* value) {
+        ConstantEnv& slots = target->isGlobal ? globalEnv : env;
+        if (target->isGlobal && !inGlobalInitializer) return;
+        int32_t constant;
+        if (target->kind == NodeKind::DeclarationInt && !value && target->isGlobal) {
+            // Globals without an initializer start out as zero
+            slots.set(target->slot, 0);
+            return;
+        }
+        if (target->kind != NodeKind::DeclarationChar && value && value->kind == NodeKind::Number &&
+            constantValue(value, constant)) {
+            slots.set(target->slot, constant);
+        } else {
+            slots.kill(target->slot);
+        }
+    }
+
+public:
+    FoldStats stats;
+
+    // Returns the folded expression, which is either node itself (possibly with
+    // folded children) or a new node the caller must substitute for it
+    ASTNode* foldExpression(ASTNode* node) {
+        int32_t left, right, result;
+        if (node->interned && !node->children.empty()) {
+            return foldShared(node);
+        }
+
+        switch (node->kind) {
+            case NodeKind::Identifier: {
+                bool visible = !node->isGlobal || inGlobalInitializer;
+                const ConstantEnv& slots = node->isGlobal ? globalEnv : env;
+                if (visible && slots.get(node->slot, result)) {
+                    stats.propagated++;
+                    return makeNumber(result);
+                }
+                return node;
+            }
+
+            case NodeKind::Assignment:
+                foldChild(node, 0);
+                recordStore(node, node->children[0]);
+                return node;
+
+            case NodeKind::BinOp:
+            case NodeKind::ComparisonOp:
+                foldChild(node, 0);
+                foldChild(node, 1);
+                if (constantValue(node->children[0], left) && constantValue(node->children[1], right) &&
+                    evalBinaryOp(node->value, left, right, result)) {
+                    stats.folded++;
+                    return makeNumber(result);
+                }
+                return node;
+
+            case NodeKind::UnaryOp:
+                foldChild(node, 0);
+                if (constantValue(node->children[0], left)) {
+                    stats.folded++;
+                    return makeNumber(evalUnaryOp(node->value, left));
+                }
+                return node;
+
+            case NodeKind::LogicalOp: {
+                bool isAnd = node->value == "&&";
+                foldChild(node, 0);
+                if (constantValue(node->children[0], left)) {
+                    // A deciding left operand means the right one never runs
+                    if (isAnd ? left == 0 : left != 0) {
+                        stats.folded++;
+                        return makeNumber(isAnd ? 0 : 1);
+                    }
+                    foldChild(node, 1);
+                    if (constantValue(node->children[1], right)) {
+                        stats.folded++;
+                        return makeNumber(right != 0);
+                    }
+                    return node;
+                }
+                // The right operand runs conditionally, so its stores are uncertain
+                ConstantEnv before = env;
+                foldChild(node, 1);
+                env.merge(before);
+                return node;
+            }
+
+            default:
+                return node;
+        }
+    }
+
+    void foldStatement(ASTNode* parent, size_t index) {
+        ASTNode* node = parent->children[index];
+
+        switch (node->kind) {
+            case NodeKind::Block:
+                for (size_t i = 0; i < node->children.size(); ++i) {
+                    foldStatement(node, i);
+                }
+                break;
+
+            case NodeKind::DeclarationInt:
+            case NodeKind::DeclarationChar:
+                if (!node->children.empty()) {
+                    foldChild(node, 0);
+                }
+                recordStore(node, node->children.empty() ? nullptr : node->children[0]);
+                break;
+
+            case NodeKind::If: {
+                foldChild(node, 0);
+                int32_t condition = 0;
+                bool isConstant = constantValue(node->children[0], condition);
+
+                ConstantEnv before = env;
+                foldStatement(node, 1);
+                ConstantEnv afterThen = env;
+                env = before;
+                if (node->children.size() > 2) {
+                    foldStatement(node, 2);
+                }
+                // With a constant condition only the taken branch's facts hold
+                if (!isConstant) {
+                    env.merge(afterThen);
+                } else if (condition != 0) {
+                    env = afterThen;
+                }
+                break;
+            }
+
+            case NodeKind::While: {
+                killAssignedIn(node);
+                ConstantEnv atLoop = env;
+                foldChild(node, 0);
+                foldStatement(node, 1);
+                env = atLoop;
+                break;
+            }
+
+            case NodeKind::For: {
+                foldStatement(node, 0);
+                killAssignedIn(node);
+                ConstantEnv atLoop = env;
+                foldChild(node, 1);
+                foldStatement(node, 3);
+                foldChild(node, 2);
+                env = atLoop;
+                break;
+            }
+
+            case NodeKind::Return:
+                if (!node->children.empty()) {
+                    foldChild(node, 0);
+                }
+                break;
+
+            default:
+                // Expression statement
+                foldChild(parent, index);
+                break;
+        }
+    }
+
+    void foldProgram(ASTNode* program) {
+        globalEnv = ConstantEnv(program->frameSize);
+        for (size_t i = 0; i < program->children.size(); ++i) {
+            ASTNode* child = program->children[i];
+            if (child->kind == NodeKind::Function) {
+                env = ConstantEnv(child->frameSize);
+                if (child->children.size() > 1) {
+                    foldStatement(child, 1);
+                }
+            } else if (child->kind == NodeKind::DeclarationInt || child->kind == NodeKind::DeclarationChar) {
+                // Global initializers run in order before main, so constants
+                // flow from one to the next
+                inGlobalInitializer = true;
+                foldStatement(program, i);
+                inGlobalInitializer = false;
+            }
+        }
+    }
+};
+
+// Runs constant folding and propagation over a resolved PROGRAM
+FoldStats foldConstants(ASTNode* program) {
+    ConstantFolder folder;
+    folder.foldProgram(program);
+    return folder.stats;
+}
+
+#endif
@@ -0,0 +1,484 @@
+#ifndef DATAFLOW_H
+#define DATAFLOW_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <string>
+#include <vector>
+#include "parser.h" // For ASTNode
+#include "visitor.h"
+
+// Fixed-size dense bit set
+class BitVector {
+private:
+    std::vector<uint64_t> words;
+    size_t bits = 0;
+
+public:
+    BitVector() = default;
+    BitVector(size_t size, bool value = false)
+        : words((size + 63) / 64, value ? ~uint64_t(0) : 0), bits(size) {
+        clearPadding();
+    }
+
+    size_t size() const { return bits; }
+
+    bool test(size_t i) const { return (words[i / 64] >> (i % 64)) & 1; }
+    void set(size_t i) { words[i / 64] |= uint64_t(1) << (i % 64); }
+    void reset(size_t i) { words[i / 64] &= ~(uint64_t(1) << (i % 64)); }
+
+    void clearPadding() {
+        if (bits % 64 != 0) {
+            words.back() &= (uint64_t(1) << (bits % 64)) - 1;
+        }
+    }
+
+    // Each returns whether this set changed
+    bool unionWith(const BitVector& other) {
+        uint64_t changed = 0;
+        for (size_t i = 0; i < words.size(); ++i) {
+            uint64_t merged = words[i] | other.words[i];
+            changed |= merged ^ words[i];
+            words[i] = merged;
+        }
+        return changed != 0;
+    }
+
+    bool intersectWith(const BitVector& other) {
+        uint64_t changed = 0;
+        for (size_t i = 0; i < words.size(); ++i) {
+            uint64_t merged = words[i] & other.words[i];
+            changed |= merged ^ words[i];
+            words[i] = merged;
+        }
+        return changed != 0;
+    }
+
+    void subtract(const BitVector& other) {
+        for (size_t i = 0; i < words.size(); ++i) {
+            words[i] &= ~other.words[i];
+        }
+    }
+
+    bool operator==(const BitVector& other) const { return words == other.words; }
+    bool operator!=(const BitVector& other) const { return words != other.words; }
+};
+
+// A straight-line run of statements and conditions. Items are leaf statements
+// (declarations, expression statements, RETURN) or the condition/update
+// expressions of IF/WHILE/FOR, in evaluation order.
+struct BasicBlock {
+    std::vector<ASTNode*> items;
+    std::vector<int> successors;
+    std::vector<int> predecessors;
+};
+
+// Control-flow graph of one FUNCTION body
+class ControlFlowGraph {
+private:
+    int newBlock() {
+        blocks.push_back(BasicBlock());
+        return static_cast<int>(blocks.size()) - 1;
+    }
+
+    void addEdge(int from, int to) {
+        blocks[from].successors.push_back(to);
+        blocks[to].predecessors.push_back(from);
+    }
+
+    // Appends the statement to the graph starting at `current`; returns the
+    // block that control falls through to afterwards
+    int buildStatement(ASTNode* node, int current) {
+        switch (node->kind) {
+            case NodeKind::Block:
+                for (ASTNode* child : node->children) {
+                    current = buildStatement(child, current);
+                }
+                return current;
+
+            case NodeKind::If: {
+                blocks[current].items.push_back(node->children[0]);
+                int thenBlock = newBlock();
+                int join = newBlock();
+                addEdge(current, thenBlock);
+                addEdge(buildStatement(node->children[1], thenBlock), join);
+                if (node->children.size() > 2) {
+                    int elseBlock = newBlock();
+                    addEdge(current, elseBlock);
+                    addEdge(buildStatement(node->children[2], elseBlock), join);
+                } else {
+                    addEdge(current, join);
+                }
+                return join;
+            }
+
+            case NodeKind::While: {
+                int header = newBlock();
+                int body = newBlock();
+                int after = newBlock();
+                addEdge(current, header);
+                blocks[header].items.push_back(node->children[0]);
+                addEdge(header, body);
+                addEdge(header, after);
+                addEdge(buildStatement(node->children[1], body), header);
+                return after;
+            }
+
+            case NodeKind::For: {
+                current = buildStatement(node->children[0], current);
+                int header = newBlock();
+                int body = newBlock();
+                int update = newBlock();
+                int after = newBlock();
+                addEdge(current, header);
+                blocks[header].items.push_back(node->children[1]);
+                addEdge(header, body);
+                addEdge(header, after);
+                addEdge(buildStatement(node->children[3], body), update);
+                blocks[update].items.push_back(node->children[2]);
+                addEdge(update, header);
+                return after;
+            }
+
+            case NodeKind::Return: {
+                blocks[current].items.push_back(node);
+                addEdge(current, exit);
+                // Anything that follows is unreachable
+                return newBlock();
+            }
+
+            default:
+                blocks[current].items.push_back(node);
+                return current;
+        }
+    }
+
+public:
+    std::vector<BasicBlock> blocks;
+    int entry = 0;
+    int exit = 1;
+
+    ControlFlowGraph(ASTNode* function) {
+        entry = newBlock();
+        exit = newBlock();
+        if (function->children.size() > 1) {
+            int last = buildStatement(function->children[1], entry);
+            addEdge(last, exit);
+        } else {
+            addEdge(entry, exit);
+        }
+    }
+
+    // Blocks reachable from entry in reverse postorder, followed by the
+    // unreachable ones
+    std::vector<int> reversePostorder() const {
+        std::vector<int> order;
+        std::vector<char> visited(blocks.size(), 0);
+        // Iterative DFS: (block, next successor index)
+        std::vector<std::pair<int, size_t>> stack;
+        stack.push_back({entry, 0});
+        visited[entry] = 1;
+        while (!stack.empty()) {
+            auto& [block, next] = stack.back();
+            if (next < blocks[block].successors.size()) {
+                int successor = blocks[block].successors[next++];
+                if (!visited[successor]) {
+                    visited[successor] = 1;
+                    stack.push_back({successor, 0});
+                }
+            } else {
+                order.push_back(block);
+                stack.pop_back();
+            }
+        }
+        std::reverse(order.begin(), order.end());
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            if (!visited[b]) order.push_back(static_cast<int>(b));
+        }
+        return order;
+    }
+};
+
+enum class FlowDirection { Forward, Backward };
+enum class FlowMeet { Union, Intersection };
+
+// A gen/kill bit-vector problem: for each block, after = gen | (before - kill),
+// where before/after follow the direction of flow
+struct DataflowProblem {
+    FlowDirection direction = FlowDirection::Forward;
+    FlowMeet meet = FlowMeet::Union;
+    size_t bits = 0;
+    BitVector boundary;            // Value at entry (forward) or exit (backward)
+    std::vector<BitVector> gen;
+    std::vector<BitVector> kill;
+};
+
+// Solution at the start (in) and end (out) of every block
+struct DataflowResult {
+    std::vector<BitVector> in;
+    std::vector<BitVector> out;
+};
+
+// Worklist solver. Blocks are processed in reverse postorder for forward
+// problems and in postorder for backward ones, so acyclic regions settle in a
+// single pass and each loop adds only a few extra passes over its body.
+DataflowResult solveDataflow(const ControlFlowGraph& cfg, const DataflowProblem& problem) {
+    size_t count = cfg.blocks.size();
+    bool forward = problem.direction == FlowDirection::Forward;
+    bool intersect = problem.meet == FlowMeet::Intersection;
+
+    // Intersection problems start from the top element so loops can only shrink
+    DataflowResult result;
+    result.in.assign(count, BitVector(problem.bits, intersect));
+    result.out.assign(count, BitVector(problem.bits, intersect));
+    int boundaryBlock = forward ? cfg.entry : cfg.exit;
+
+    std::vector<int> order = cfg.reversePostorder();
+    if (!forward) std::reverse(order.begin(), order.end());
+    std::vector<int> priority(count);
+    for (size_t i = 0; i < order.size(); ++i) {
+        priority[order[i]] = static_cast<int>(i);
+    }
+
+    std::priority_queue<int, std::vector<int>, std::greater<int>> worklist;
+    std::vector<char> queued(count, 1);
+    for (size_t i = 0; i < order.size(); ++i) {
+        worklist.push(static_cast<int>(i));
+    }
+
+    while (!worklist.empty()) {
+        int block = order[worklist.top()];
+        worklist.pop();
+        queued[block] = 0;
+
+        const std::vector<int>& sources = forward ? cfg.blocks[block].predecessors : cfg.blocks[block].successors;
+        const std::vector<int>& targets = forward ? cfg.blocks[block].successors : cfg.blocks[block].predecessors;
+        BitVector& before = forward ? result.in[block] : result.out[block];
+        BitVector& after = forward ? result.out[block] : result.in[block];
+
+        if (block == boundaryBlock) {
+            before = problem.boundary;
+        } else if (!sources.empty()) {
+            before = forward ? result.out[sources[0]] : result.in[sources[0]];
+            for (size_t i = 1; i < sources.size(); ++i) {
+                const BitVector& incoming = forward ? result.out[sources[i]] : result.in[sources[i]];
+                if (intersect) before.intersectWith(incoming);
+                else before.unionWith(incoming);
+            }
+        }
+
+        BitVector updated = before;
+        updated.subtract(problem.kill[block]);
+        updated.unionWith(problem.gen[block]);
+        if (updated != after) {
+            after = updated;
+            for (int target : targets) {
+                if (!queued[target]) {
+                    queued[target] = 1;
+                    worklist.push(priority[target]);
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+// --- Clients ---------------------------------------------------------------
+
+enum class AccessKind { Read, Write, Kill };
+
+// Reports the local-variable accesses of one CFG item in evaluation order.
+// Writes in the right operand of && and || are marked conditional, since they
+// may not happen. A declaration without an initializer kills its slot.
+class AccessWalker : public ASTVisitor<AccessWalker> {
+private:
+    std::function<void(AccessKind, ASTNode*, bool)> callback;
+    bool conditional = false;
+
+    void declaration(ASTNode* node) {
+        visitChildren(node);
+        if (!node->isGlobal) {
+            callback(node->children.empty() ? AccessKind::Kill : AccessKind::Write, node, conditional);
+        }
+    }
+
+public:
+    AccessWalker(std::function<void(AccessKind, ASTNode*, bool)> cb) : callback(std::move(cb)) {}
+
+    void visitDeclarationInt(ASTNode* node) { declaration(node); }
+    void visitDeclarationChar(ASTNode* node) { declaration(node); }
+
+    void visitAssignment(ASTNode* node) {
+        visitChildren(node);
+        if (!node->isGlobal) callback(AccessKind::Write, node, conditional);
+    }
+
+    void visitIdentifier(ASTNode* node) {
+        if (!node->isGlobal) callback(AccessKind::Read, node, conditional);
+    }
+
+    void visitLogicalOp(ASTNode* node) {
+        visit(node->children[0]);
+        bool saved = conditional;
+        conditional = true;
+        visit(node->children[1]);
+        conditional = saved;
+    }
+};
+
+void forEachAccess(ASTNode* item, std::function<void(AccessKind, ASTNode*, bool)> callback) {
+    AccessWalker walker(std::move(callback));
+    walker.visit(item);
+}
+
+struct Access {
+    AccessKind kind;
+    ASTNode* node;
+    bool conditional;
+};
+
+// The accesses of one item, in evaluation order, for passes that walk them
+// backwards; out is cleared first so callers can reuse it
+void collectAccesses(ASTNode* item, std::vector<Access>& out) {
+    out.clear();
+    forEachAccess(item, [&](AccessKind kind, ASTNode* node, bool conditional) {
+        out.push_back({kind, node, conditional});
+    });
+}
+
+// Forward must-problem: a slot is set when it has been assigned on every path
+DataflowProblem definiteAssignmentProblem(const ControlFlowGraph& cfg, int frameSize) {
+    DataflowProblem problem;
+    problem.direction = FlowDirection::Forward;
+    problem.meet = FlowMeet::Intersection;
+    problem.bits = frameSize;
+    problem.boundary = BitVector(frameSize);
+
+    for (const BasicBlock& block : cfg.blocks) {
+        BitVector gen(frameSize), kill(frameSize);
+        for (ASTNode* item : block.items) {
+            forEachAccess(item, [&](AccessKind kind, ASTNode* node, bool conditional) {
+                if (kind == AccessKind::Write && !conditional) {
+                    gen.set(node->slot);
+                    kill.reset(node->slot);
+                } else if (kind == AccessKind::Kill) {
+                    kill.set(node->slot);
+                    gen.reset(node->slot);
+                }
+            });
+        }
+        problem.gen.push_back(gen);
+        problem.kill.push_back(kill);
+    }
+    return problem;
+}
+
+// Backward may-problem: a slot is set when its current value may still be read
+DataflowProblem livenessProblem(const ControlFlowGraph& cfg, int frameSize) {
+    DataflowProblem problem;
+    problem.direction = FlowDirection::Backward;
+    problem.meet = FlowMeet::Union;
+    problem.bits = frameSize;
+    problem.boundary = BitVector(frameSize);
+
+    std::vector<Access> accesses;
+    for (const BasicBlock& block : cfg.blocks) {
+        BitVector gen(frameSize), kill(frameSize);
+        // Backwards one access at a time, so a read later in the same
+        // expression keeps an earlier write live
+        for (auto it = block.items.rbegin(); it != block.items.rend(); ++it) {
+            collectAccesses(*it, accesses);
+            for (auto access = accesses.rbegin(); access != accesses.rend(); ++access) {
+                int slot = access->node->slot;
+                if (access->kind == AccessKind::Read) {
+                    gen.set(slot);
+                } else if (!access->conditional) {
+                    gen.reset(slot);
+                    kill.set(slot);
+                }
+            }
+        }
+        problem.gen.push_back(gen);
+        problem.kill.push_back(kill);
+    }
+    return problem;
+}
+
+// Runs definite assignment and liveness over every FUNCTION and returns
+// warnings for reads of possibly uninitialized locals and for stored values
+// that are never read. Requires resolveNames to have run.
+std::vector<std::string> analyzeFlow(ASTNode* program) {
+    std::vector<std::string> warnings;
+
+    for (ASTNode* function : program->children) {
+        if (function->kind != NodeKind::Function) continue;
+        int frameSize = function->frameSize;
+        ControlFlowGraph cfg(function);
+
+        DataflowResult assigned = solveDataflow(cfg, definiteAssignmentProblem(cfg, frameSize));
+        BitVector reported(frameSize);
+        // Slots written inside the right operand of && or || count as
+        // assigned only for the rest of that item's conditional accesses
+        BitVector conditionallySet(frameSize);
+        std::vector<int> conditionalSlots;
+        for (size_t b = 0; b < cfg.blocks.size(); ++b) {
+            BitVector state = assigned.in[b];
+            for (ASTNode* item : cfg.blocks[b].items) {
+                forEachAccess(item, [&](AccessKind kind, ASTNode* node, bool conditional) {
+                    int slot = node->slot;
+                    if (kind == AccessKind::Read) {
+                        bool set = state.test(slot) || (conditional && conditionallySet.test(slot));
+                        if (!set && !reported.test(slot)) {
+                            reported.set(slot);
+                            warnings.push_back("'" + node->value + "' may be used uninitialized in " + function->value);
+                        }
+                    } else if (kind == AccessKind::Write) {
+                        if (conditional) {
+                            conditionallySet.set(slot);
+                            conditionalSlots.push_back(slot);
+                        } else {
+                            state.set(slot);
+                        }
+                    } else {
+                        state.reset(slot);
+                        conditionallySet.reset(slot);
+                    }
+                });
+                for (int slot : conditionalSlots) conditionallySet.reset(slot);
+                conditionalSlots.clear();
+            }
+        }
+
+        DataflowResult live = solveDataflow(cfg, livenessProblem(cfg, frameSize));
+        std::vector<Access> accesses;
+        for (size_t b = 0; b < cfg.blocks.size(); ++b) {
+            std::vector<std::string> deadStores;
+            BitVector state = live.out[b];
+            const std::vector<ASTNode*>& items = cfg.blocks[b].items;
+            for (auto it = items.rbegin(); it != items.rend(); ++it) {
+                collectAccesses(*it, accesses);
+                for (auto access = accesses.rbegin(); access != accesses.rend(); ++access) {
+                    int slot = access->node->slot;
+                    if (access->kind == AccessKind::Read) {
+                        state.set(slot);
+                        continue;
+                    }
+                    if (access->kind == AccessKind::Write && !state.test(slot)) {
+                        deadStores.push_back("value assigned to '" + access->node->value + "' in " +
+                                             function->value + " is never read");
+                    }
+                    if (!access->conditional) state.reset(slot);
+                }
+            }
+            // Collected backwards; report in source order
+            warnings.insert(warnings.end(), deadStores.rbegin(), deadStores.rend());
+        }
+    }
+
+    return warnings;
+}
+
+#endif
@@ -0,0 +1,249 @@
+#ifndef DEADCODE_H
+#define DEADCODE_H
+
+#include <cstdint>
+#include <vector>
+#include "parser.h" // For ASTNode
+#include "visitor.h"
+#include "constfold.h" // For constantValue
+
+// Number of nodes a subtree frees when it is released. Interned nodes stay
+// in the pool for their other parents, so they and their (also interned)
+// children are not counted.
+int countNodes(const ASTNode* node) {
+    if (!node || node->interned) return 0;
+    int count = 1;
+    for (const ASTNode* child : node->children) {
+        count += countNodes(child);
+    }
+    return count;
+}
+
+// Whether evaluating the expression can do anything besides produce a value:
+// assign a variable, or trap on a division that is not by a nonzero constant
+bool hasSideEffects(const ASTNode* node) {
+    if (node->kind == NodeKind::Assignment) return true;
+    if (node->kind == NodeKind::BinOp && node->value == "/") {
+        int32_t divisor;
+        if (!constantValue(node->children[1], divisor) || divisor == 0) return true;
+    }
+    for (const ASTNode* child : node->children) {
+        if (hasSideEffects(child)) return true;
+    }
+    return false;
+}
+
+// Marks the local slots that are ever read
+class ReadSlots : public ASTVisitor<ReadSlots> {
+public:
+    std::vector<char> read;
+
+    ReadSlots(int frameSize) : read(frameSize, 0) {}
+
+    void visitIdentifier(ASTNode* node) {
+        if (!node->isGlobal) read[node->slot] = 1;
+    }
+};
+
+// Removes code that can never run or whose results are never used:
+// statements after a RETURN (or anything else that never falls through),
+// IF branches and loops whose condition is a literal, and local variables that
+// are never read together with the stores to them. Runs after constant folding
+// so conditions that became literals are caught too.
+class DeadCodeEliminator {
+private:
+    std::vector<char> read; // Per slot of the function being processed
+    bool changed = false;
+
+    void discard(ASTNode* node) {
+        removed += countNodes(node);
+        releaseNode(node);
+    }
+
+    // Detaches parent->children[index] so deleting parent leaves it alone
+    ASTNode* detach(ASTNode* parent, size_t index) {
+        ASTNode* child = parent->children[index];
+        parent->children[index] = nullptr;
+        return child;
+    }
+
+    static bool isLiteral(const ASTNode* node, int32_t& value) {
+        return constantValue(node, value);
+    }
+
+    // Whether control never continues past the statement
+    static bool terminates(const ASTNode* node) {
+        int32_t condition;
+        switch (node->kind) {
+            case NodeKind::Return:
+                return true;
+            case NodeKind::Block:
+                return !node->children.empty() && terminates(node->children.back());
+            case NodeKind::If:
+                return node->children.size() > 2 && terminates(node->children[1]) && terminates(node->children[2]);
+            case NodeKind::While:
+                // There is no break, so an endless loop only leaves through RETURN
+                return isLiteral(node->children[0], condition) && condition != 0;
+            case NodeKind::For:
+                return isLiteral(node->children[1], condition) && condition != 0;
+            default:
+                return false;
+        }
+    }
+
+    void simplifyBlock(ASTNode* block) {
+        std::vector<ASTNode*> kept;
+        bool unreachable = false;
+        for (ASTNode* child : block->children) {
+            if (unreachable) {
+                discard(child);
+                changed = true;
+                continue;
+            }
+            ASTNode* simplified = simplifyStatement(child);
+            if (!simplified) continue;
+            if (simplified->kind == NodeKind::Block && simplified->children.empty()) {
+                discard(simplified);
+                continue;
+            }
+            kept.push_back(simplified);
+            unreachable = terminates(simplified);
+        }
+        block->children = kept;
+    }
+
+    // Returns the replacement for the statement, or nullptr if it was removed
+    ASTNode* simplifyStatement(ASTNode* node) {
+        int32_t condition;
+
+        switch (node->kind) {
+            case NodeKind::Block:
+                simplifyBlock(node);
+                return node;
+
+            case NodeKind::If: {
+                node->children[0] = removeUnreadStores(node->children[0]);
+                if (isLiteral(node->children[0], condition)) {
+                    changed = true;
+                    size_t taken = condition != 0 ? 1 : 2;
+                    ASTNode* branch = taken < node->children.size() ? detach(node, taken) : nullptr;
+                    discard(node);
+                    return branch ? simplifyStatement(branch) : nullptr;
+                }
+                simplifyStatement(node->children[1]);
+                if (node->children.size() > 2) {
+                    ASTNode* elseBranch = simplifyStatement(node->children[2]);
+                    if (!elseBranch) {
+                        node->children.pop_back();
+                    } else {
+                        node->children[2] = elseBranch;
+                    }
+                }
+                return node;
+            }
+
+            case NodeKind::While:
+                node->children[0] = removeUnreadStores(node->children[0]);
+                if (isLiteral(node->children[0], condition) && condition == 0) {
+                    changed = true;
+                    discard(node);
+                    return nullptr;
+                }
+                simplifyStatement(node->children[1]);
+                return node;
+
+            case NodeKind::For:
+                for (size_t i = 0; i < 3; ++i) {
+                    node->children[i] = removeUnreadStores(node->children[i]);
+                }
+                if (isLiteral(node->children[1], condition) && condition == 0) {
+                    // Only the initialization runs; keep it in its own scope
+                    changed = true;
+                    ASTNode* block = new ASTNode("BLOCK");
+                    block->addChild(detach(node, 0));
+                    discard(node);
+                    return simplifyStatement(block);
+                }
+                simplifyStatement(node->children[3]);
+                return node;
+
+            case NodeKind::DeclarationInt:
+            case NodeKind::DeclarationChar:
+                if (!node->isGlobal && !read[node->slot]) {
+                    changed = true;
+                    // Keep an initializer that does more than compute a value
+                    ASTNode* init = nullptr;
+                    if (!node->children.empty() && hasSideEffects(node->children[0])) {
+                        init = removeUnreadStores(detach(node, 0));
+                    }
+                    discard(node);
+                    return init;
+                }
+                if (!node->children.empty()) {
+                    node->children[0] = removeUnreadStores(node->children[0]);
+                }
+                return node;
+
+            case NodeKind::Return:
+                if (!node->children.empty()) {
+                    node->children[0] = removeUnreadStores(node->children[0]);
+                }
+                return node;
+
+            default: {
+                // Expression statement: drop it if it computes nothing observable
+                ASTNode* expr = removeUnreadStores(node);
+                if (!hasSideEffects(expr)) {
+                    changed = true;
+                    discard(expr);
+                    return nullptr;
+                }
+                return expr;
+            }
+        }
+    }
+
+    // Rewrites stores to never-read locals into just their value
+    ASTNode* removeUnreadStores(ASTNode* node) {
+        // Shared nodes are side-effect free and so contain no stores
+        if (node->interned) return node;
+        for (size_t i = 0; i < node->children.size(); ++i) {
+            node->children[i] = removeUnreadStores(node->children[i]);
+        }
+        if (node->kind == NodeKind::Assignment && !node->isGlobal && !read[node->slot]) {
+            changed = true;
+            ASTNode* value = detach(node, 0);
+            discard(node);
+            return value;
+        }
+        return node;
+    }
+
+public:
+    int removed = 0;
+
+    void eliminate(ASTNode* program) {
+        for (ASTNode* function : program->children) {
+            if (function->kind != NodeKind::Function || function->children.size() < 2) continue;
+
+            // Removing a store can leave another variable unread, so repeat
+            do {
+                changed = false;
+                ReadSlots reads(function->frameSize);
+                reads.visit(function);
+                read = reads.read;
+                simplifyStatement(function->children[1]);
+            } while (changed);
+        }
+    }
+};
+
+// Runs dead-code elimination over a resolved PROGRAM; returns the number of
+// AST nodes removed
+int eliminateDeadCode(ASTNode* program) {
+    DeadCodeEliminator eliminator;
+    eliminator.eliminate(program);
+    return eliminator.removed;
+}
+
+#endif
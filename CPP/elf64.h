@@ -0,0 +1,316 @@
+#ifndef ELF64_H
+#define ELF64_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <elf.h>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "process.h"
+#include "x86.h"
+#include "x86encode.h"
+
+// A program ready to be written out: .text holds clp_main followed by the
+// entry stub, .rodata the error messages and .bss the globals and status.
+// RIP-relative references from .text into the other sections are listed
+// as fixups, which become relocations in an object file and are resolved
+// directly in an executable.
+struct NativeImage {
+    enum class Section { Rodata, Bss };
+    struct Fixup {
+        size_t offset;  // Of the rel32 field in .text
+        Section section;
+        int32_t target; // Offset in that section
+    };
+
+    std::vector<uint8_t> text;
+    size_t entry = 0; // The stub, exported as main
+    std::vector<uint8_t> rodata;
+    uint32_t bssSize = 0;
+    std::vector<Fixup> fixups;
+};
+
+// Builds the image for a compiled function. The stub matches the one
+// printed by x86asm.h: it calls clp_main, reports a runtime error status
+// like the interpreter does and kills itself with the error's signal (see
+// process.h), and otherwise exits with main's value through exit_group, so
+// it serves both as a libc main and as a static _start.
+NativeImage buildNativeImage(const X86Function& function) {
+    NativeImage image;
+    image.text = encodeX86(function).bytes;
+    while (image.text.size() % 16) image.text.push_back(0xCC);
+    image.entry = image.text.size();
+
+    const std::string divideMessage = "Runtime Error: Division by zero\n";
+    const std::string stringMessage = "Runtime Error: String values are not supported at runtime\n";
+    image.rodata.assign(divideMessage.begin(), divideMessage.end());
+    image.rodata.insert(image.rodata.end(), stringMessage.begin(), stringMessage.end());
+    int32_t globalBytes = 4 * std::max<int32_t>(function.globalCount, 1);
+    int32_t statusOffset = (globalBytes + 15) / 16 * 16;
+    image.bssSize = statusOffset + 4;
+
+    std::vector<uint8_t>& out = image.text;
+    auto bytes = [&](std::initializer_list<uint8_t> values) { out.insert(out.end(), values); };
+    auto imm32 = [&](int32_t value) {
+        for (int i = 0; i < 4; ++i) out.push_back(static_cast<uint8_t>(static_cast<uint32_t>(value) >> (8 * i)));
+    };
+    auto ripTo = [&](NativeImage::Section section, int32_t target) {
+        image.fixups.push_back({out.size(), section, target});
+        imm32(0);
+    };
+    using Section = NativeImage::Section;
+
+    bytes({0x48, 0x8D, 0x3D}); ripTo(Section::Bss, 0);             // lea rdi, [rip+globals]
+    bytes({0x48, 0x8D, 0x35}); ripTo(Section::Bss, statusOffset);  // lea rsi, [rip+status]
+    bytes({0xE8}); imm32(-static_cast<int32_t>(out.size() + 4));   // call clp_main
+    bytes({0x89, 0xC7});                                           // mov edi, eax
+    bytes({0x8B, 0x0D}); ripTo(Section::Bss, statusOffset);        // mov ecx, [rip+status]
+    bytes({0x85, 0xC9});                                           // test ecx, ecx
+    bytes({0x74, 0x4A});                                           // je exit
+    bytes({0x48, 0x8D, 0x35}); ripTo(Section::Rodata, 0);          // lea rsi, [rip+divide message]
+    bytes({0xBA}); imm32(static_cast<int32_t>(divideMessage.size())); // mov edx, length
+    bytes({0xBB}); imm32(kDivideByZeroSignal);                     // mov ebx, signal
+    bytes({0x83, 0xF9, static_cast<uint8_t>(kX86DivideByZero)});  // cmp ecx, 1
+    bytes({0x74, 0x11});                                           // je report
+    bytes({0x48, 0x8D, 0x35}); ripTo(Section::Rodata, static_cast<int32_t>(divideMessage.size()));
+    bytes({0xBA}); imm32(static_cast<int32_t>(stringMessage.size())); // mov edx, length
+    bytes({0xBB}); imm32(kStringValueSignal);                      // mov ebx, signal
+    bytes({0xBF}); imm32(2);                                       // report: mov edi, 2
+    bytes({0xB8}); imm32(1);                                       // mov eax, 1 (write)
+    bytes({0x0F, 0x05});                                           // syscall
+    bytes({0xB8}); imm32(39);                                      // mov eax, 39 (getpid)
+    bytes({0x0F, 0x05});                                           // syscall
+    bytes({0x89, 0xC7});                                           // mov edi, eax
+    bytes({0x89, 0xDE});                                           // mov esi, ebx
+    bytes({0xB8}); imm32(62);                                      // mov eax, 62 (kill)
+    bytes({0x0F, 0x05});                                           // syscall
+    bytes({0xBF}); imm32(1);                                       // mov edi, 1
+    bytes({0xB8}); imm32(231);                                     // exit: mov eax, 231 (exit_group)
+    bytes({0x0F, 0x05});                                           // syscall
+    return image;
+}
+
+namespace elf {
+
+template <typename T>
+void append(std::vector<uint8_t>& out, const T& value) {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), data, data + sizeof(T));
+}
+
+void align(std::vector<uint8_t>& out, size_t alignment) {
+    while (out.size() % alignment) out.push_back(0);
+}
+
+uint32_t addString(std::vector<uint8_t>& table, const std::string& name) {
+    uint32_t offset = static_cast<uint32_t>(table.size());
+    table.insert(table.end(), name.begin(), name.end());
+    table.push_back(0);
+    return offset;
+}
+
+Elf64_Ehdr header(uint16_t type) {
+    Elf64_Ehdr ehdr{};
+    std::memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+    ehdr.e_ident[EI_CLASS] = ELFCLASS64;
+    ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+    ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+    ehdr.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+    ehdr.e_type = type;
+    ehdr.e_machine = EM_X86_64;
+    ehdr.e_version = EV_CURRENT;
+    ehdr.e_ehsize = sizeof(Elf64_Ehdr);
+    return ehdr;
+}
+
+void writeFile(const std::string& path, const std::vector<uint8_t>& data, bool executable) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not write " + path);
+    }
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    file.close();
+    if (executable) {
+        std::filesystem::permissions(path, std::filesystem::perms::owner_all | std::filesystem::perms::group_read |
+                                               std::filesystem::perms::group_exec | std::filesystem::perms::others_read |
+                                               std::filesystem::perms::others_exec);
+    }
+}
+
+} // namespace elf
+
+// Writes a relocatable ELF64 object defining main; link it with `cc`
+void writeElfObject(const std::string& path, const NativeImage& image) {
+    enum { Null, Text, Rodata, Bss, RelaText, Symtab, Strtab, Shstrtab, NoteStack, SectionCount };
+    std::vector<uint8_t> out;
+    elf::append(out, Elf64_Ehdr{});
+
+    elf::align(out, 16);
+    size_t textOffset = out.size();
+    out.insert(out.end(), image.text.begin(), image.text.end());
+    size_t rodataOffset = out.size();
+    out.insert(out.end(), image.rodata.begin(), image.rodata.end());
+
+    // Symbols: null, the three section symbols, clp_main, then global main
+    std::vector<uint8_t> strtab(1, 0);
+    std::vector<Elf64_Sym> symbols(1, Elf64_Sym{});
+    for (uint16_t section : {Text, Rodata, Bss}) {
+        Elf64_Sym symbol{};
+        symbol.st_info = ELF64_ST_INFO(STB_LOCAL, STT_SECTION);
+        symbol.st_shndx = section;
+        symbols.push_back(symbol);
+    }
+    Elf64_Sym function{};
+    function.st_name = elf::addString(strtab, "clp_main");
+    function.st_info = ELF64_ST_INFO(STB_LOCAL, STT_FUNC);
+    function.st_shndx = Text;
+    function.st_size = image.entry;
+    symbols.push_back(function);
+    Elf64_Sym mainSymbol{};
+    mainSymbol.st_name = elf::addString(strtab, "main");
+    mainSymbol.st_info = ELF64_ST_INFO(STB_GLOBAL, STT_FUNC);
+    mainSymbol.st_shndx = Text;
+    mainSymbol.st_value = image.entry;
+    mainSymbol.st_size = image.text.size() - image.entry;
+    symbols.push_back(mainSymbol);
+    const uint32_t firstGlobal = static_cast<uint32_t>(symbols.size() - 1);
+
+    elf::align(out, 8);
+    size_t relaOffset = out.size();
+    for (const NativeImage::Fixup& fixup : image.fixups) {
+        Elf64_Rela rela{};
+        rela.r_offset = fixup.offset;
+        uint32_t symbol = fixup.section == NativeImage::Section::Rodata ? 2 : 3;
+        rela.r_info = ELF64_R_INFO(symbol, R_X86_64_PC32);
+        rela.r_addend = fixup.target - 4;
+        elf::append(out, rela);
+    }
+    size_t symtabOffset = out.size();
+    for (const Elf64_Sym& symbol : symbols) elf::append(out, symbol);
+    size_t strtabOffset = out.size();
+    out.insert(out.end(), strtab.begin(), strtab.end());
+
+    std::vector<uint8_t> shstrtab(1, 0);
+    const char* names[] = {"", ".text", ".rodata", ".bss", ".rela.text", ".symtab", ".strtab", ".shstrtab",
+                           ".note.GNU-stack"};
+    std::vector<uint32_t> nameOffsets(SectionCount, 0);
+    for (int i = 1; i < SectionCount; ++i) nameOffsets[i] = elf::addString(shstrtab, names[i]);
+    size_t shstrtabOffset = out.size();
+    out.insert(out.end(), shstrtab.begin(), shstrtab.end());
+
+    std::vector<Elf64_Shdr> sections(SectionCount, Elf64_Shdr{});
+    auto section = [&](int index, uint32_t type, uint64_t flags, size_t offset, size_t size, uint64_t alignment) {
+        Elf64_Shdr& shdr = sections[index];
+        shdr.sh_name = nameOffsets[index];
+        shdr.sh_type = type;
+        shdr.sh_flags = flags;
+        shdr.sh_offset = offset;
+        shdr.sh_size = size;
+        shdr.sh_addralign = alignment;
+        return &shdr;
+    };
+    section(Text, SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, textOffset, image.text.size(), 16);
+    section(Rodata, SHT_PROGBITS, SHF_ALLOC, rodataOffset, image.rodata.size(), 1);
+    section(Bss, SHT_NOBITS, SHF_ALLOC | SHF_WRITE, rodataOffset + image.rodata.size(), image.bssSize, 16);
+    Elf64_Shdr* rela = section(RelaText, SHT_RELA, SHF_INFO_LINK, relaOffset, symtabOffset - relaOffset, 8);
+    rela->sh_link = Symtab;
+    rela->sh_info = Text;
+    rela->sh_entsize = sizeof(Elf64_Rela);
+    Elf64_Shdr* symtab = section(Symtab, SHT_SYMTAB, 0, symtabOffset, strtabOffset - symtabOffset, 8);
+    symtab->sh_link = Strtab;
+    symtab->sh_info = firstGlobal;
+    symtab->sh_entsize = sizeof(Elf64_Sym);
+    section(Strtab, SHT_STRTAB, 0, strtabOffset, strtab.size(), 1);
+    section(Shstrtab, SHT_STRTAB, 0, shstrtabOffset, shstrtab.size(), 1);
+    section(NoteStack, SHT_PROGBITS, 0, shstrtabOffset + shstrtab.size(), 0, 1);
+
+    elf::align(out, 8);
+    Elf64_Ehdr ehdr = elf::header(ET_REL);
+    ehdr.e_shoff = out.size();
+    ehdr.e_shentsize = sizeof(Elf64_Shdr);
+    ehdr.e_shnum = SectionCount;
+    ehdr.e_shstrndx = Shstrtab;
+    for (const Elf64_Shdr& shdr : sections) elf::append(out, shdr);
+    std::memcpy(out.data(), &ehdr, sizeof(ehdr));
+    elf::writeFile(path, out, false);
+}
+
+// Writes a static ELF64 executable with no dependencies: one read-execute
+// segment for the headers, code and messages, one zero-filled read-write
+// segment for the globals
+void writeElfExecutable(const std::string& path, const NativeImage& image) {
+    const uint64_t base = 0x400000;
+    const uint64_t page = 0x1000;
+    std::vector<uint8_t> out;
+    elf::append(out, Elf64_Ehdr{});
+    elf::append(out, Elf64_Phdr{});
+    elf::append(out, Elf64_Phdr{});
+
+    elf::align(out, 16);
+    size_t textOffset = out.size();
+    std::vector<uint8_t> text = image.text;
+    size_t rodataOffset = textOffset + text.size();
+    uint64_t bssAddress = (base + rodataOffset + image.rodata.size() + page - 1) / page * page + page;
+
+    for (const NativeImage::Fixup& fixup : image.fixups) {
+        uint64_t target = fixup.section == NativeImage::Section::Rodata ? base + rodataOffset + fixup.target
+                                                                        : bssAddress + fixup.target;
+        int32_t displacement = static_cast<int32_t>(target - (base + textOffset + fixup.offset + 4));
+        std::memcpy(&text[fixup.offset], &displacement, 4);
+    }
+    out.insert(out.end(), text.begin(), text.end());
+    out.insert(out.end(), image.rodata.begin(), image.rodata.end());
+
+    Elf64_Ehdr ehdr = elf::header(ET_EXEC);
+    ehdr.e_entry = base + textOffset + image.entry;
+    ehdr.e_phoff = sizeof(Elf64_Ehdr);
+    ehdr.e_phentsize = sizeof(Elf64_Phdr);
+    ehdr.e_phnum = 2;
+
+    Elf64_Phdr code{};
+    code.p_type = PT_LOAD;
+    code.p_flags = PF_R | PF_X;
+    code.p_vaddr = code.p_paddr = base;
+    code.p_filesz = code.p_memsz = out.size();
+    code.p_align = page;
+
+    Elf64_Phdr data{};
+    data.p_type = PT_LOAD;
+    data.p_flags = PF_R | PF_W;
+    data.p_vaddr = data.p_paddr = bssAddress;
+    data.p_memsz = image.bssSize;
+    data.p_align = page;
+
+    std::memcpy(out.data(), &ehdr, sizeof(ehdr));
+    std::memcpy(out.data() + sizeof(ehdr), &code, sizeof(code));
+    std::memcpy(out.data() + sizeof(ehdr) + sizeof(code), &data, sizeof(data));
+    elf::writeFile(path, out, true);
+}
+
+// Writes the program as a static executable in a scratch directory, runs
+// it and returns its exit status. A runtime error is thrown like the
+// interpreter's.
+int32_t runNative(const X86Function& function) {
+    char pattern[] = "/tmp/clp-XXXXXX";
+    if (!mkdtemp(pattern)) {
+        throw std::runtime_error("Could not create a build directory");
+    }
+    std::filesystem::path directory = pattern;
+    std::string executable = (directory / "program").string();
+    int status = -1;
+    try {
+        writeElfExecutable(executable, buildNativeImage(function));
+        status = runCompiledProgram(executable, "Native program");
+    } catch (...) {
+        std::filesystem::remove_all(directory);
+        throw;
+    }
+    std::filesystem::remove_all(directory);
+    return status;
+}
+
+#endif
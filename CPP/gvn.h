@@ -0,0 +1,172 @@
+#ifndef GVN_H
+#define GVN_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ir.h"
+#include "ssa.h"
+
+struct GVNStats {
+    int redundant = 0; // Expressions already computed on every path to them
+    int copies = 0;    // Copies whose uses now read the copied value
+    int phis = 0;      // Phis that merge a single value or repeat another phi
+};
+
+// Dominator-based global value numbering over SSA (Briggs, Cooper and
+// Simpson). Walking the dominator tree, every pure expression is looked up
+// by its opcode and the leaders of its operands; if a dominating block
+// already computed it, the later copy is removed and its uses read the
+// earlier value. Copies are removed the same way, so the whole pass also
+// does copy propagation. Globals are left alone, since a store on any
+// path in between would change what a load reads.
+class ValueNumbering {
+private:
+    struct Key {
+        IROp op;
+        int32_t a;
+        int32_t b;
+        bool operator==(const Key& other) const { return op == other.op && a == other.a && b == other.b; }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            uint64_t mixed = (static_cast<uint64_t>(static_cast<uint32_t>(key.a)) << 32) ^ static_cast<uint32_t>(key.b);
+            return std::hash<uint64_t>()(mixed * 31 + static_cast<uint64_t>(key.op));
+        }
+    };
+
+    // Orders phi operand lists, so phis in one block can be matched
+    struct PhiArgsLess {
+        bool operator()(const std::vector<IRPhiArg>& x, const std::vector<IRPhiArg>& y) const {
+            return std::lexicographical_compare(x.begin(), x.end(), y.begin(), y.end(),
+                                                [](const IRPhiArg& l, const IRPhiArg& r) {
+                                                    return l.block != r.block ? l.block < r.block : l.value < r.value;
+                                                });
+        }
+    };
+    using PhiMap = std::map<std::vector<IRPhiArg>, int32_t, PhiArgsLess>;
+
+    IRFunction& function;
+    std::vector<int32_t> leader; // By value: the value that replaces it
+    std::unordered_map<Key, int32_t, KeyHash> available;
+    std::vector<Key> scope;      // Keys added, undone when leaving a subtree
+    std::vector<size_t> scopeMarks;
+
+    int32_t find(int32_t value) {
+        while (leader[value] != value) value = leader[value] = leader[leader[value]];
+        return value;
+    }
+
+    static bool isPure(IROp op) {
+        // A Div only runs if the one dominating it did not trap
+        return op == IROp::Const || op == IROp::Neg || op == IROp::Not || isIRBinary(op);
+    }
+
+    // Puts equivalent expressions in one form: commutative operands in
+    // value order, and > and >= as < and <= with their operands swapped
+    static Key keyOf(const IRInstr& instr) {
+        Key key = {instr.op, instr.a, instr.b};
+        if (instr.op == IROp::Gt || instr.op == IROp::Ge) {
+            key = {instr.op == IROp::Gt ? IROp::Lt : IROp::Le, instr.b, instr.a};
+        } else if ((instr.op == IROp::Add || instr.op == IROp::Mul || instr.op == IROp::MulHigh ||
+                    instr.op == IROp::Eq || instr.op == IROp::Ne) &&
+                   key.a > key.b) {
+            std::swap(key.a, key.b);
+        }
+        return key;
+    }
+
+    void replace(IRInstr& instr, int32_t value, int& counter) {
+        leader[instr.dest] = value;
+        instr = IRInstr();
+        counter++;
+    }
+
+    void visitBlock(int32_t b, GVNStats& stats) {
+        const IRBlock& block = function.blocks[b];
+        PhiMap phis;
+        for (uint32_t i = block.begin; i < block.end; ++i) {
+            IRInstr& instr = function.code[i];
+            if (instr.op == IROp::Phi) {
+                visitPhi(instr, phis, stats);
+                continue;
+            }
+            forEachIRUse(instr, [&](int32_t& v) { v = find(v); });
+            if (instr.op == IROp::Copy) {
+                replace(instr, instr.a, stats.copies);
+            } else if (isPure(instr.op)) {
+                Key key = keyOf(instr);
+                auto found = available.find(key);
+                if (found != available.end()) {
+                    replace(instr, found->second, stats.redundant);
+                } else {
+                    available.emplace(key, instr.dest);
+                    scope.push_back(key);
+                }
+            }
+        }
+    }
+
+    // Operands from back edges are not numbered yet and are compared as
+    // they are, which only misses some chances
+    void visitPhi(IRInstr& instr, PhiMap& phis, GVNStats& stats) {
+        std::vector<IRPhiArg> args;
+        int32_t single = -1;
+        bool merges = false;
+        for (int32_t k = 0; k < instr.b; ++k) {
+            IRPhiArg& arg = function.phiArgs[instr.a + k];
+            arg.value = find(arg.value);
+            args.push_back(arg);
+            if (arg.value == instr.dest) continue;
+            if (single >= 0 && single != arg.value) merges = true;
+            single = arg.value;
+        }
+        if (!merges && single >= 0) {
+            replace(instr, single, stats.phis);
+            return;
+        }
+        std::sort(args.begin(), args.end(), [](const IRPhiArg& l, const IRPhiArg& r) { return l.block < r.block; });
+        auto inserted = phis.emplace(std::move(args), instr.dest);
+        if (!inserted.second) replace(instr, inserted.first->second, stats.phis);
+    }
+
+public:
+    explicit ValueNumbering(IRFunction& function) : function(function) {}
+
+    void run(GVNStats& stats) {
+        leader.resize(function.valueCount());
+        for (int32_t v = 0; v < function.valueCount(); ++v) leader[v] = v;
+        DominatorTree tree = buildDominators(function);
+        tree.walk([&](int32_t b, bool entering) {
+            if (entering) {
+                scopeMarks.push_back(scope.size());
+                visitBlock(b, stats);
+                return;
+            }
+            for (size_t mark = scopeMarks.back(); scope.size() > mark; scope.pop_back()) available.erase(scope.back());
+            scopeMarks.pop_back();
+        });
+
+        // Phi operands on back edges, and anything else read before its
+        // replacement was found
+        for (IRInstr& instr : function.code) {
+            if (instr.op == IROp::Phi) {
+                for (int32_t k = 0; k < instr.b; ++k) {
+                    IRPhiArg& arg = function.phiArgs[instr.a + k];
+                    arg.value = find(arg.value);
+                }
+            } else {
+                forEachIRUse(instr, [&](int32_t& v) { v = find(v); });
+            }
+        }
+        packIR(function, unpackIR(function));
+    }
+};
+
+#endif
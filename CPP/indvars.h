@@ -0,0 +1,368 @@
+#ifndef INDVARS_H
+#define INDVARS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "arith.h"
+#include "ir.h"
+#include "ssa.h"
+#include "licm.h" // For findLoops
+
+struct IVStats {
+    int inductionVariables = 0; // Header phis stepped by a constant each iteration
+    int reduced = 0;            // Multiplications replaced by adding a step
+    int testsReplaced = 0;      // Loop exit tests moved onto a reduced variable
+    int divisions = 0;          // Divisions by a constant replaced by multiplies
+};
+
+// Multiplier and shift that divide by a constant, from Hacker's Delight
+// (Warren, 10-1): x / d is the high half of x * multiplier, corrected by x
+// when their signs disagree, shifted right, plus one if that is negative.
+// divisor must not be -1, 0 or 1.
+struct DivisionMagic {
+    int32_t multiplier;
+    int32_t shift;
+};
+
+DivisionMagic divisionMagic(int32_t divisor) {
+    const uint32_t two31 = 0x80000000u;
+    uint32_t ad = divisor < 0 ? 0u - static_cast<uint32_t>(divisor) : static_cast<uint32_t>(divisor);
+    uint32_t t = two31 + (static_cast<uint32_t>(divisor) >> 31);
+    uint32_t anc = t - 1 - t % ad; // |nc|, the largest dividend with a full remainder
+    int32_t p = 31;
+    uint32_t q1 = two31 / anc, r1 = two31 - q1 * anc;
+    uint32_t q2 = two31 / ad, r2 = two31 - q2 * ad;
+    uint32_t delta;
+    do {
+        p++;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc) {
+            q1++;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= ad) {
+            q2++;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+    int32_t multiplier = static_cast<int32_t>(q2 + 1);
+    return {divisor < 0 ? wrapNeg(multiplier) : multiplier, p - 32};
+}
+
+// Induction-variable optimizations over SSA with loop preheaders. A basic
+// induction variable is a header phi that enters as some value and comes
+// around the back edge as itself plus a constant. Multiplying one by a
+// loop-invariant value is strength-reduced: a new header phi starts at
+// init * k and adds step * k on each iteration. When the loop's exit test
+// compares the variable with a constant and the trip count is known
+// without overflow, the test is rewritten as an inequality on the reduced
+// variable (linear-function test replacement), which often leaves the
+// original variable dead. Finally, every division by a constant becomes a
+// multiply-and-shift sequence.
+class InductionVariables {
+private:
+    struct Induction {
+        int32_t phi;
+        int32_t init;
+        int32_t step;
+        int32_t next;  // phi + step, the value on the back edge
+        int32_t latch;
+    };
+
+    struct Reduction {
+        int32_t value;  // Tracks phi * factor
+        int32_t factor; // Only recorded for constant factors
+    };
+
+    IRFunction& function;
+    IRDraft draft;
+    std::vector<IRInstr> definition;  // By value; Nop if not defined
+    std::vector<int32_t> defBlock;
+    std::vector<int32_t> replacement; // By value, or -1
+    std::unordered_map<int32_t, std::vector<IRInstr>> insertAfter; // By the dest they follow
+    std::vector<std::vector<IRInstr>> append; // By block, before its terminator
+    std::vector<IRInstr> constants;           // For the entry block
+    std::unordered_map<int32_t, int32_t> constantValues;
+
+    int32_t newValue(IROp op, int32_t a, int32_t b, int32_t block) {
+        int32_t value = function.newValue();
+        definition.push_back({op, value, a, b});
+        defBlock.push_back(block);
+        replacement.push_back(-1);
+        return value;
+    }
+
+    int32_t constant(int32_t number) {
+        auto found = constantValues.find(number);
+        if (found != constantValues.end()) return found->second;
+        int32_t value = newValue(IROp::Const, number, -1, 0);
+        constants.push_back(definition[value]);
+        constantValues.emplace(number, value);
+        return value;
+    }
+
+    bool isConstant(int32_t value, int32_t& number) const {
+        if (definition[value].op != IROp::Const) return false;
+        number = definition[value].a;
+        return true;
+    }
+
+    int32_t emitIn(int32_t block, IROp op, int32_t a, int32_t b) {
+        int32_t value = newValue(op, a, b, block);
+        append[block].push_back(definition[value]);
+        return value;
+    }
+
+    void findInductions(const IRLoop& loop, const std::vector<int32_t>& inLoop, int32_t stamp,
+                        std::vector<Induction>& inductions) {
+        for (const IRInstr& instr : draft.blocks[loop.header].code) {
+            if (instr.op != IROp::Phi) continue;
+            const std::vector<IRPhiArg>& args = draft.phis[instr.a];
+            if (args.size() != 2) continue;
+            int entering = args[0].block == loop.preheader ? 0 : 1;
+            const IRPhiArg& around = args[1 - entering];
+            if (args[entering].block != loop.preheader || inLoop[around.block] != stamp) continue;
+            if (defBlock[around.value] < 0 || inLoop[defBlock[around.value]] != stamp) continue;
+            const IRInstr& next = definition[around.value];
+            int32_t step;
+            bool stepped = next.op == IROp::Add && ((next.a == instr.dest && isConstant(next.b, step)) ||
+                                                   (next.b == instr.dest && isConstant(next.a, step)));
+            if (!stepped && next.op == IROp::Sub && next.a == instr.dest && isConstant(next.b, step)) {
+                step = wrapNeg(step);
+                stepped = true;
+            }
+            if (!stepped) continue;
+            inductions.push_back({instr.dest, args[entering].value, step, around.value, around.block});
+        }
+    }
+
+    // Replaces mul = iv * factor with a phi that adds step * factor
+    int32_t reduce(const IRLoop& loop, const Induction& iv, int32_t factor, std::vector<IRInstr>& headerPhis) {
+        int32_t factorConstant, initConstant;
+        bool constantFactor = isConstant(factor, factorConstant);
+        bool constantInit = isConstant(iv.init, initConstant);
+        int32_t step, start;
+        if (constantFactor) {
+            step = constant(wrapMul(iv.step, factorConstant));
+        } else {
+            step = iv.step == 1 ? factor : emitIn(loop.preheader, IROp::Mul, factor, constant(iv.step));
+        }
+        if (constantFactor && constantInit) {
+            start = constant(wrapMul(initConstant, factorConstant));
+        } else if (constantInit && initConstant == 0) {
+            start = iv.init;
+        } else {
+            start = emitIn(loop.preheader, IROp::Mul, iv.init, factor);
+        }
+        int32_t reduced = newValue(IROp::Phi, static_cast<int32_t>(draft.phis.size()), 0, loop.header);
+        int32_t next = newValue(IROp::Add, reduced, step, defBlock[iv.next]);
+        draft.phis.push_back({{loop.preheader, start}, {iv.latch, next}});
+        headerPhis.push_back(definition[reduced]);
+        insertAfter[iv.next].push_back(definition[next]);
+        return reduced;
+    }
+
+    // Trip-count check for linear-function test replacement: the value of
+    // the variable when the test first fails, if no step overflows
+    static bool exitValue(IROp op, int64_t init, int64_t step, int64_t bound, int64_t& last) {
+        if (op == IROp::Le) bound++;
+        if (op == IROp::Ge) bound--;
+        if (op == IROp::Lt || op == IROp::Le) {
+            if (step <= 0) return false;
+            last = init >= bound ? init : init + (bound - init + step - 1) / step * step;
+        } else if (op == IROp::Gt || op == IROp::Ge) {
+            if (step >= 0) return false;
+            last = init <= bound ? init : init + (init - bound - step - 1) / -step * step;
+        } else {
+            return false;
+        }
+        return last >= INT32_MIN && last <= INT32_MAX;
+    }
+
+    // The comparison that gives the same answer with its operands swapped
+    static IROp swappedComparison(IROp op) {
+        switch (op) {
+            case IROp::Lt: return IROp::Gt;
+            case IROp::Le: return IROp::Ge;
+            case IROp::Gt: return IROp::Lt;
+            case IROp::Ge: return IROp::Le;
+            default: return op;
+        }
+    }
+
+    static bool fits(int64_t value) { return value >= INT32_MIN && value <= INT32_MAX; }
+
+    void replaceTest(const IRLoop& loop, const std::vector<int32_t>& inLoop, int32_t stamp,
+                     const std::vector<Induction>& inductions, const std::vector<std::vector<Reduction>>& reductions,
+                     IVStats& stats) {
+        const IRBlockDraft& header = draft.blocks[loop.header];
+        const IRInstr& branch = header.code.back();
+        if (branch.op != IROp::Branch || inLoop[header.succ[0]] != stamp || inLoop[header.succ[1]] == stamp) return;
+        int32_t condition = branch.a;
+        IRInstr test = definition[condition];
+        if (defBlock[condition] < 0 || inLoop[defBlock[condition]] != stamp) return;
+        for (size_t i = 0; i < inductions.size(); ++i) {
+            const Induction& iv = inductions[i];
+            IROp op;
+            int32_t bound, init;
+            if (test.a == iv.phi && isConstant(test.b, bound)) {
+                op = test.op;
+            } else if (test.b == iv.phi && isConstant(test.a, bound)) {
+                op = swappedComparison(test.op);
+            } else {
+                continue;
+            }
+            int64_t last;
+            if (!isConstant(iv.init, init) || !exitValue(op, init, iv.step, bound, last)) continue;
+            for (const Reduction& reduction : reductions[i]) {
+                int64_t factor = reduction.factor;
+                if (factor == 0 || !fits(init * factor) || !fits(last * factor)) continue;
+                // Every value the variable takes maps to a distinct multiple,
+                // and only the last fails the original test
+                for (IRInstr& instr : draft.blocks[defBlock[condition]].code) {
+                    if (instr.dest == condition) {
+                        instr = {IROp::Ne, condition, reduction.value,
+                                 constant(static_cast<int32_t>(last * factor))};
+                    }
+                }
+                definition[condition] = {IROp::Ne, condition, reduction.value, -1};
+                stats.testsReplaced++;
+                return;
+            }
+        }
+    }
+
+    void optimizeLoop(const IRLoop& loop, std::vector<int32_t>& inLoop, int32_t stamp, IVStats& stats) {
+        for (int32_t b : loop.blocks) inLoop[b] = stamp;
+        std::vector<Induction> inductions;
+        findInductions(loop, inLoop, stamp, inductions);
+        if (inductions.empty()) return;
+        stats.inductionVariables += static_cast<int>(inductions.size());
+        std::vector<std::vector<Reduction>> reductions(inductions.size());
+        std::vector<IRInstr> headerPhis;
+        auto invariant = [&](int32_t value) { return defBlock[value] >= 0 && inLoop[defBlock[value]] != stamp; };
+        for (int32_t b : loop.blocks) {
+            for (IRInstr& instr : draft.blocks[b].code) {
+                if (instr.op != IROp::Mul) continue;
+                for (size_t i = 0; i < inductions.size(); ++i) {
+                    int32_t phi = inductions[i].phi;
+                    int32_t factor = instr.a == phi ? instr.b : instr.b == phi ? instr.a : -1;
+                    if (factor < 0 || factor == phi || !invariant(factor)) continue;
+                    int32_t reduced = reduce(loop, inductions[i], factor, headerPhis);
+                    int32_t factorConstant;
+                    if (isConstant(factor, factorConstant)) reductions[i].push_back({reduced, factorConstant});
+                    replacement[instr.dest] = reduced;
+                    instr = IRInstr();
+                    stats.reduced++;
+                    break;
+                }
+            }
+        }
+        std::vector<IRInstr>& header = draft.blocks[loop.header].code;
+        header.insert(header.begin(), headerPhis.begin(), headerPhis.end());
+        replaceTest(loop, inLoop, stamp, inductions, reductions, stats);
+    }
+
+    void rewriteDivisions(IVStats& stats) {
+        for (size_t b = 0; b < draft.blocks.size(); ++b) {
+            for (IRInstr& instr : draft.blocks[b].code) {
+                int32_t divisor;
+                if (instr.op != IROp::Div || !isConstant(instr.b, divisor) || divisor == 0) continue;
+                stats.divisions++;
+                int32_t x = instr.a, dest = instr.dest;
+                if (divisor == 1) {
+                    replacement[dest] = x;
+                    instr = IRInstr();
+                    continue;
+                }
+                if (divisor == -1) {
+                    instr = {IROp::Neg, dest, x, -1};
+                    continue;
+                }
+                DivisionMagic magic = divisionMagic(divisor);
+                int32_t block = static_cast<int32_t>(b);
+                int32_t high = newValue(IROp::MulHigh, x, constant(magic.multiplier), block);
+                std::vector<IRInstr> sequence;
+                auto then = [&](IROp op, int32_t a, int32_t operand) {
+                    int32_t value = newValue(op, a, operand, block);
+                    sequence.push_back(definition[value]);
+                    return value;
+                };
+                int32_t q = high;
+                if (divisor > 0 && magic.multiplier < 0) q = then(IROp::Add, q, x);
+                if (divisor < 0 && magic.multiplier > 0) q = then(IROp::Sub, q, x);
+                if (magic.shift > 0) q = then(IROp::Shr, q, constant(magic.shift));
+                // Round toward zero: add one when the quotient is negative
+                int32_t sign = then(IROp::Shr, q, constant(31));
+                sequence.push_back({IROp::Sub, dest, q, sign});
+                instr = definition[high];
+                insertAfter[high] = sequence;
+            }
+        }
+    }
+
+public:
+    explicit InductionVariables(IRFunction& function) : function(function) {}
+
+    void run(IVStats& stats) {
+        int changesBefore = stats.reduced + stats.divisions;
+        DominatorTree tree = buildDominators(function);
+        std::vector<IRLoop> loops = findLoops(function, tree);
+        std::sort(loops.begin(), loops.end(),
+                  [](const IRLoop& x, const IRLoop& y) { return x.blocks.size() < y.blocks.size(); });
+        draft = unpackIR(function);
+        definition.assign(function.valueCount(), IRInstr());
+        defBlock.assign(function.valueCount(), -1);
+        replacement.assign(function.valueCount(), -1);
+        append.assign(draft.blocks.size(), {});
+        for (size_t b = 0; b < draft.blocks.size(); ++b) {
+            for (const IRInstr& instr : draft.blocks[b].code) {
+                if (instr.dest < 0) continue;
+                definition[instr.dest] = instr;
+                defBlock[instr.dest] = static_cast<int32_t>(b);
+                if (b == 0 && instr.op == IROp::Const) constantValues.emplace(instr.a, instr.dest);
+            }
+        }
+
+        std::vector<int32_t> inLoop(draft.blocks.size(), -1);
+        for (size_t id = 0; id < loops.size(); ++id) {
+            const IRLoop& loop = loops[id];
+            if (loop.preheader < 0 || draft.blocks[loop.preheader].succ[1] >= 0) continue;
+            optimizeLoop(loop, inLoop, static_cast<int32_t>(id), stats);
+        }
+        rewriteDivisions(stats);
+        if (stats.reduced + stats.divisions == changesBefore) return;
+
+        auto resolve = [&](int32_t& value) {
+            while (replacement[value] >= 0) value = replacement[value];
+        };
+        for (size_t b = 0; b < draft.blocks.size(); ++b) {
+            std::vector<IRInstr> code = b == 0 ? constants : std::vector<IRInstr>();
+            for (const IRInstr& instr : draft.blocks[b].code) {
+                if (isIRTerminator(instr.op)) code.insert(code.end(), append[b].begin(), append[b].end());
+                code.push_back(instr);
+                auto after = instr.dest >= 0 ? insertAfter.find(instr.dest) : insertAfter.end();
+                if (after != insertAfter.end()) code.insert(code.end(), after->second.begin(), after->second.end());
+            }
+            // The entry's constants may now be used earlier in it
+            if (b == 0) {
+                std::stable_partition(code.begin(), code.end(),
+                                      [](const IRInstr& instr) { return instr.op == IROp::Const; });
+            }
+            for (IRInstr& instr : code) forEachIRUse(instr, resolve);
+            draft.blocks[b].code = std::move(code);
+        }
+        for (std::vector<IRPhiArg>& args : draft.phis) {
+            for (IRPhiArg& arg : args) resolve(arg.value);
+        }
+        packIR(function, draft);
+    }
+};
+
+#endif
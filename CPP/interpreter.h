@@ -0,0 +1,176 @@
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "parser.h" // For ASTNode
+#include "visitor.h"
+#include "arith.h"
+
+// Finds the FUNCTION named main; the last definition wins, as in the symbol table
+ASTNode* findMainFunction(ASTNode* program) {
+    ASTNode* mainFunction = nullptr;
+    for (ASTNode* child : program->children) {
+        if (child->kind == NodeKind::Function && child->value == "main") {
+            mainFunction = child;
+        }
+    }
+    if (!mainFunction) {
+        throw std::runtime_error("No main function to run");
+    }
+    return mainFunction;
+}
+
+// Executes a resolved AST directly. Variables live in a global array and a
+// per-call frame array indexed by the slots from name resolution, so nothing
+// is looked up by name at runtime. Statements return 0 and set `returning`
+// when a RETURN runs; expressions return their value. Engines that change
+// how some nodes run (see tiered.h) derive from this and override hooks.
+template <typename Derived>
+class BasicInterpreter : public ASTVisitor<Derived, int32_t> {
+protected:
+    std::vector<int32_t> globals;
+    std::vector<int32_t> frame;
+    bool returning = false;
+    int32_t returnValue = 0;
+    ASTNode* program = nullptr;
+    ASTNode* currentFunction = nullptr;
+
+    int32_t& variable(const ASTNode* node) {
+        return node->isGlobal ? globals[node->slot] : frame[node->slot];
+    }
+
+    int32_t declare(ASTNode* node) {
+        // Uninitialized variables start out as zero
+        variable(node) = node->children.empty() ? 0 : this->visit(node->children[0]);
+        return 0;
+    }
+
+public:
+    // Runs the global initializers, then main; returns main's exit code
+    int32_t run(ASTNode* root) {
+        program = root;
+        ASTNode* mainFunction = findMainFunction(program);
+        globals.assign(program->frameSize, 0);
+        for (ASTNode* child : program->children) {
+            if (child->kind == NodeKind::DeclarationInt || child->kind == NodeKind::DeclarationChar) {
+                declare(child);
+            }
+        }
+        return call(mainFunction);
+    }
+
+    int32_t call(ASTNode* function) {
+        std::vector<int32_t> callerFrame(function->frameSize, 0);
+        ASTNode* caller = currentFunction;
+        currentFunction = function;
+        frame.swap(callerFrame);
+        returning = false;
+        returnValue = 0;
+        if (function->children.size() > 1) {
+            this->visit(function->children[1]);
+        }
+        frame.swap(callerFrame);
+        currentFunction = caller;
+        returning = false;
+        return returnValue;
+    }
+
+    // Statements
+
+    int32_t visitBlock(ASTNode* node) {
+        for (ASTNode* child : node->children) {
+            this->visit(child);
+            if (returning) break;
+        }
+        return 0;
+    }
+
+    int32_t visitDeclarationInt(ASTNode* node) { return declare(node); }
+    int32_t visitDeclarationChar(ASTNode* node) { return declare(node); }
+
+    int32_t visitIf(ASTNode* node) {
+        if (this->visit(node->children[0]) != 0) {
+            this->visit(node->children[1]);
+        } else if (node->children.size() > 2) {
+            this->visit(node->children[2]);
+        }
+        return 0;
+    }
+
+    int32_t visitWhile(ASTNode* node) {
+        while (!returning && this->visit(node->children[0]) != 0) {
+            this->visit(node->children[1]);
+        }
+        return 0;
+    }
+
+    int32_t visitFor(ASTNode* node) {
+        for (this->visit(node->children[0]); this->visit(node->children[1]) != 0; this->visit(node->children[2])) {
+            this->visit(node->children[3]);
+            if (returning) break;
+        }
+        return 0;
+    }
+
+    int32_t visitReturn(ASTNode* node) {
+        returnValue = node->children.empty() ? 0 : this->visit(node->children[0]);
+        returning = true;
+        return 0;
+    }
+
+    // Expressions
+
+    int32_t visitAssignment(ASTNode* node) {
+        int32_t value = this->visit(node->children[0]);
+        variable(node) = value;
+        return value;
+    }
+
+    int32_t visitBinOp(ASTNode* node) {
+        int32_t left = this->visit(node->children[0]);
+        int32_t right = this->visit(node->children[1]);
+        int32_t result;
+        if (!evalBinaryOp(node->value, left, right, result)) {
+            throw std::runtime_error("Division by zero");
+        }
+        return result;
+    }
+
+    int32_t visitComparisonOp(ASTNode* node) { return visitBinOp(node); }
+
+    int32_t visitLogicalOp(ASTNode* node) {
+        bool left = this->visit(node->children[0]) != 0;
+        if (node->value == "&&" ? !left : left) {
+            return left;
+        }
+        return this->visit(node->children[1]) != 0;
+    }
+
+    int32_t visitUnaryOp(ASTNode* node) {
+        return evalUnaryOp(node->value, this->visit(node->children[0]));
+    }
+
+    int32_t visitNumber(ASTNode* node) { return node->literal; }
+    int32_t visitChar(ASTNode* node) { return node->literal; }
+
+    int32_t visitString(ASTNode*) {
+        throw std::runtime_error("String values are not supported at runtime");
+    }
+
+    int32_t visitIdentifier(ASTNode* node) { return variable(node); }
+
+    int32_t visitDefault(ASTNode*) { return 0; }
+};
+
+class Interpreter : public BasicInterpreter<Interpreter> {};
+
+// Interprets a resolved PROGRAM and returns main's exit code
+int32_t interpretProgram(ASTNode* program) {
+    Interpreter interpreter;
+    return interpreter.run(program);
+}
+
+#endif
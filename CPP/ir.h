@@ -0,0 +1,711 @@
+#ifndef IR_H
+#define IR_H
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "parser.h" // For ASTNode
+#include "arith.h"
+#include "interpreter.h" // For findMainFunction
+
+// Three-address IR. Every instruction defines at most one value (dest) from
+// up to two value operands; values are numbered per function, and the first
+// frameSize of them are the function's locals at their frame slots. Before
+// SSA construction a value may be assigned many times, and like frame slots
+// every value starts out as zero. Const keeps its constant in a, the global
+// instructions keep the global slot in a, and a Phi's operands are the
+// phiArgs [a, a + b). MulHigh and Shr have no source syntax; they come
+// from rewriting division by a constant. Jump, Branch and Return end a
+// block; the blocks they go to are the block's successors, not operands.
+#define IR_OPCODES(X)  \
+    X(Nop)             \
+    X(Const)           \
+    X(Copy)            \
+    X(Neg)             \
+    X(Not)             \
+    X(Add)             \
+    X(Sub)             \
+    X(Mul)             \
+    X(Div)             \
+    X(MulHigh)         \
+    X(Shr)             \
+    X(Eq)              \
+    X(Ne)              \
+    X(Lt)              \
+    X(Le)              \
+    X(Gt)              \
+    X(Ge)              \
+    X(LoadGlobal)      \
+    X(StoreGlobal)     \
+    X(StringValue)     \
+    X(Phi)             \
+    X(Jump)            \
+    X(Branch)          \
+    X(Return)
+
+enum class IROp : uint8_t {
+#define IR_ENUM(name) name,
+    IR_OPCODES(IR_ENUM)
+#undef IR_ENUM
+};
+
+const char* irOpName(IROp op) {
+    static const char* const names[] = {
+#define IR_NAME(name) #name,
+        IR_OPCODES(IR_NAME)
+#undef IR_NAME
+    };
+    return names[static_cast<int>(op)];
+}
+
+struct IRInstr {
+    IROp op = IROp::Nop;
+    int32_t dest = -1;
+    int32_t a = -1;
+    int32_t b = -1;
+};
+
+// One phi operand: the value flowing in from predecessor block
+struct IRPhiArg {
+    int32_t block;
+    int32_t value;
+};
+
+struct IRBlock {
+    uint32_t begin = 0;          // Instructions [begin, end) of IRFunction::code;
+    uint32_t end = 0;            // the last one is the terminator
+    int32_t succ[2] = {-1, -1};  // Jump: succ[0]; Branch: taken, not taken
+    uint32_t predBegin = 0;      // Predecessors [predBegin, predBegin + predCount)
+    uint32_t predCount = 0;      // of IRFunction::preds
+};
+
+// A function's control-flow graph, with every instruction, block, edge and
+// phi operand in one flat array each. blocks[0] is the entry.
+struct IRFunction {
+    std::string name;
+    std::vector<IRInstr> code;
+    std::vector<IRBlock> blocks;
+    std::vector<int32_t> preds;
+    std::vector<IRPhiArg> phiArgs;
+    std::vector<int32_t> valueSlots;     // By value: the local it is a version of, or -1
+    std::vector<std::string> localNames; // By frame slot, for dumps
+    int32_t frameSize = 0;
+
+    int32_t valueCount() const { return static_cast<int32_t>(valueSlots.size()); }
+
+    int32_t newValue(int32_t slot = -1) {
+        valueSlots.push_back(slot);
+        return valueCount() - 1;
+    }
+
+    const int32_t* predsOf(int32_t block) const { return preds.data() + blocks[block].predBegin; }
+};
+
+struct IRProgram {
+    std::vector<IRFunction> functions;
+    int32_t globalCount = 0;
+    int32_t mainIndex = -1; // The function that runs
+};
+
+bool isIRTerminator(IROp op) { return op == IROp::Jump || op == IROp::Branch || op == IROp::Return; }
+
+bool isIRBinary(IROp op) { return op >= IROp::Add && op <= IROp::Ge; }
+
+// Whether removing the instruction could change what the program does when
+// its result is unused: stores, and operations that may trap
+bool hasIRSideEffect(const IRInstr& instr) {
+    return instr.op == IROp::StoreGlobal || instr.op == IROp::StringValue || instr.op == IROp::Div ||
+           isIRTerminator(instr.op);
+}
+
+// Calls use(operand) for each value the instruction reads, passing a
+// reference into instr: passes that rename operands hand in a mutable
+// instruction, and readers a const one. Phi operands are read on the
+// incoming edges instead and are not included.
+template <typename Instr, typename Use>
+void forEachIRUse(Instr& instr, Use use) {
+    static_assert(std::is_same<std::remove_const_t<Instr>, IRInstr>::value, "forEachIRUse takes an IRInstr");
+    switch (instr.op) {
+        case IROp::Copy:
+        case IROp::Neg:
+        case IROp::Not:
+        case IROp::Branch:
+        case IROp::Return:
+            use(instr.a);
+            break;
+        case IROp::StoreGlobal:
+            use(instr.b);
+            break;
+        default:
+            if (isIRBinary(instr.op)) {
+                use(instr.a);
+                use(instr.b);
+            }
+            break;
+    }
+}
+
+// Folds an operation on constants; returns false if it would trap
+bool evalIROp(IROp op, int32_t a, int32_t b, int32_t& result) {
+    switch (op) {
+        case IROp::Copy: result = a; return true;
+        case IROp::Neg: result = wrapNeg(a); return true;
+        case IROp::Not: result = a == 0; return true;
+        case IROp::Add: result = wrapAdd(a, b); return true;
+        case IROp::Sub: result = wrapSub(a, b); return true;
+        case IROp::Mul: result = wrapMul(a, b); return true;
+        case IROp::Div:
+            if (b == 0) return false;
+            result = wrapDiv(a, b);
+            return true;
+        case IROp::MulHigh: result = mulHigh(a, b); return true;
+        case IROp::Shr: result = shiftRight(a, b); return true;
+        case IROp::Eq: result = a == b; return true;
+        case IROp::Ne: result = a != b; return true;
+        case IROp::Lt: result = a < b; return true;
+        case IROp::Le: result = a <= b; return true;
+        case IROp::Gt: result = a > b; return true;
+        case IROp::Ge: result = a >= b; return true;
+        default: return false;
+    }
+}
+
+// An editable form of a function for passes that add, remove or reorder
+// blocks and instructions: one instruction vector per block, with phi
+// operand lists kept aside. packIR turns it back into flat arrays.
+struct IRBlockDraft {
+    std::vector<IRInstr> code;
+    int32_t succ[2] = {-1, -1};
+};
+
+struct IRDraft {
+    std::vector<IRBlockDraft> blocks;
+    std::vector<std::vector<IRPhiArg>> phis; // Operands of each Phi, indexed by IRInstr::a
+};
+
+IRDraft unpackIR(const IRFunction& function) {
+    IRDraft draft;
+    draft.blocks.resize(function.blocks.size());
+    for (size_t b = 0; b < function.blocks.size(); ++b) {
+        const IRBlock& block = function.blocks[b];
+        IRBlockDraft& target = draft.blocks[b];
+        target.code.assign(function.code.begin() + block.begin, function.code.begin() + block.end);
+        target.succ[0] = block.succ[0];
+        target.succ[1] = block.succ[1];
+        for (IRInstr& instr : target.code) {
+            if (instr.op != IROp::Phi) continue;
+            draft.phis.emplace_back(function.phiArgs.begin() + instr.a, function.phiArgs.begin() + instr.a + instr.b);
+            instr.a = static_cast<int32_t>(draft.phis.size() - 1);
+        }
+    }
+    return draft;
+}
+
+// Flattens a draft into function: drops blocks unreachable from the entry,
+// Nops, and phi operands from blocks that are no longer predecessors,
+// moves each block's phis to its start, and numbers the remaining blocks
+// in their draft order
+void packIR(IRFunction& function, const IRDraft& draft) {
+    size_t count = draft.blocks.size();
+    std::vector<int32_t> number(count, -1);
+    std::vector<int32_t> worklist = {0};
+    number[0] = 0;
+    while (!worklist.empty()) {
+        int32_t b = worklist.back();
+        worklist.pop_back();
+        for (int32_t succ : draft.blocks[b].succ) {
+            if (succ >= 0 && number[succ] < 0) {
+                number[succ] = 0;
+                worklist.push_back(succ);
+            }
+        }
+    }
+    int32_t next = 0;
+    for (size_t b = 0; b < count; ++b) {
+        if (number[b] >= 0) number[b] = next++;
+    }
+
+    // Predecessors in block order, counted first so they can be laid out
+    // in place
+    auto forEachEdge = [&](auto visit) {
+        for (size_t b = 0; b < count; ++b) {
+            if (number[b] < 0) continue;
+            const IRBlockDraft& block = draft.blocks[b];
+            if (block.succ[0] >= 0) visit(number[block.succ[0]], number[b]);
+            if (block.succ[1] >= 0 && block.succ[1] != block.succ[0]) visit(number[block.succ[1]], number[b]);
+        }
+    };
+    function.blocks.assign(next, IRBlock());
+    forEachEdge([&](int32_t to, int32_t) { function.blocks[to].predCount++; });
+    uint32_t edges = 0;
+    size_t instructions = 0;
+    for (size_t b = 0; b < count; ++b) {
+        if (number[b] >= 0) instructions += draft.blocks[b].code.size();
+    }
+    for (IRBlock& block : function.blocks) {
+        block.predBegin = edges;
+        edges += block.predCount;
+        block.predCount = 0;
+    }
+    function.preds.assign(edges, -1);
+    forEachEdge([&](int32_t to, int32_t from) {
+        IRBlock& block = function.blocks[to];
+        function.preds[block.predBegin + block.predCount++] = from;
+    });
+
+    function.code.clear();
+    function.code.reserve(instructions);
+    function.phiArgs.clear();
+    for (size_t b = 0; b < count; ++b) {
+        int32_t n = number[b];
+        if (n < 0) continue;
+        const IRBlockDraft& source = draft.blocks[b];
+        IRBlock& block = function.blocks[n];
+        block.begin = static_cast<uint32_t>(function.code.size());
+        for (int phis = 1; phis >= 0; --phis) {
+            for (IRInstr instr : source.code) {
+                if (instr.op == IROp::Nop || (instr.op == IROp::Phi) != (phis == 1)) continue;
+                if (instr.op == IROp::Phi) {
+                    int32_t first = static_cast<int32_t>(function.phiArgs.size());
+                    for (const IRPhiArg& arg : draft.phis[instr.a]) {
+                        int32_t from = arg.block >= 0 && static_cast<size_t>(arg.block) < count ? number[arg.block] : -1;
+                        const int32_t* preds = function.predsOf(n);
+                        if (from >= 0 && std::find(preds, preds + block.predCount, from) != preds + block.predCount) {
+                            function.phiArgs.push_back({from, arg.value});
+                        }
+                    }
+                    instr.a = first;
+                    instr.b = static_cast<int32_t>(function.phiArgs.size()) - first;
+                }
+                function.code.push_back(instr);
+            }
+        }
+        block.end = static_cast<uint32_t>(function.code.size());
+        block.succ[0] = source.succ[0] >= 0 ? number[source.succ[0]] : -1;
+        block.succ[1] = source.succ[1] >= 0 ? number[source.succ[1]] : -1;
+    }
+}
+
+// Lowers the resolved AST of one FUNCTION to IR. Expressions are evaluated
+// left to right as in the interpreter; && and || become branches.
+class IRLowering {
+private:
+    ASTNode* program;
+    IRFunction& function;
+    IRDraft draft;
+    int32_t current = 0;
+    uint64_t localStores = 0; // Copies into locals so far
+
+    int32_t newBlock() {
+        draft.blocks.emplace_back();
+        return static_cast<int32_t>(draft.blocks.size() - 1);
+    }
+
+    void emit(IROp op, int32_t dest, int32_t a = -1, int32_t b = -1) {
+        draft.blocks[current].code.push_back({op, dest, a, b});
+    }
+
+    int32_t emitValue(IROp op, int32_t a = -1, int32_t b = -1) {
+        int32_t dest = function.newValue();
+        emit(op, dest, a, b);
+        return dest;
+    }
+
+    // Ends the current block; code after a return or jump goes into a fresh
+    // block that packIR drops as unreachable
+    void jump(int32_t target) {
+        emit(IROp::Jump, -1);
+        draft.blocks[current].succ[0] = target;
+    }
+
+    void branch(int32_t condition, int32_t taken, int32_t notTaken) {
+        emit(IROp::Branch, -1, condition);
+        draft.blocks[current].succ[0] = taken;
+        draft.blocks[current].succ[1] = notTaken;
+    }
+
+    void nameLocal(ASTNode* node) {
+        if (node->isGlobal || node->slot >= function.frameSize) return;
+        std::string& name = function.localNames[node->slot];
+        if (name.empty()) name = node->value;
+    }
+
+    int32_t store(ASTNode* target, int32_t value) {
+        if (target->slot < 0) {
+            throw std::runtime_error("Unresolved variable: " + target->value);
+        }
+        if (target->isGlobal) {
+            emit(IROp::StoreGlobal, -1, target->slot, value);
+        } else {
+            nameLocal(target);
+            emit(IROp::Copy, target->slot, value);
+            localStores++;
+        }
+        return value;
+    }
+
+    // Evaluates both operands of a binary operator in order. A local read
+    // on the left is used directly unless the right side assigns a local,
+    // in which case a copy is taken where the left was evaluated.
+    std::pair<int32_t, int32_t> operands(ASTNode* node) {
+        int32_t left = expression(node->children[0]);
+        int32_t leftBlock = current;
+        size_t leftEnd = draft.blocks[current].code.size();
+        uint64_t storesBefore = localStores;
+        int32_t right = expression(node->children[1]);
+        if (left < function.frameSize && localStores != storesBefore) {
+            int32_t copy = function.newValue();
+            std::vector<IRInstr>& code = draft.blocks[leftBlock].code;
+            code.insert(code.begin() + static_cast<std::ptrdiff_t>(leftEnd), IRInstr{IROp::Copy, copy, left, -1});
+            left = copy;
+        }
+        return {left, right};
+    }
+
+    int32_t expression(ASTNode* node) {
+        switch (node->kind) {
+            case NodeKind::Number:
+            case NodeKind::Char:
+                return emitValue(IROp::Const, node->literal);
+
+            case NodeKind::String:
+                return emitValue(IROp::StringValue);
+
+            case NodeKind::Identifier:
+                if (node->slot < 0) {
+                    throw std::runtime_error("Unresolved variable: " + node->value);
+                }
+                if (node->isGlobal) return emitValue(IROp::LoadGlobal, node->slot);
+                nameLocal(node);
+                return node->slot;
+
+            case NodeKind::Assignment:
+                return store(node, expression(node->children[0]));
+
+            case NodeKind::UnaryOp:
+                return emitValue(node->value == "-" ? IROp::Neg : IROp::Not, expression(node->children[0]));
+
+            case NodeKind::BinOp:
+            case NodeKind::ComparisonOp: {
+                auto [left, right] = operands(node);
+                return emitValue(binaryOp(node->value), left, right);
+            }
+
+            case NodeKind::LogicalOp: {
+                // result = left != 0; if it decides the answer skip the right
+                int32_t zero = emitValue(IROp::Const, 0);
+                int32_t result = emitValue(IROp::Ne, expression(node->children[0]), zero);
+                int32_t right = newBlock(), done = newBlock();
+                if (node->value == "&&") {
+                    branch(result, right, done);
+                } else {
+                    branch(result, done, right);
+                }
+                current = right;
+                emit(IROp::Ne, result, expression(node->children[1]), emitValue(IROp::Const, 0));
+                jump(done);
+                current = done;
+                return result;
+            }
+
+            default:
+                return emitValue(IROp::Const, 0);
+        }
+    }
+
+    static IROp binaryOp(const std::string& op) {
+        if (op == "+") return IROp::Add;
+        if (op == "-") return IROp::Sub;
+        if (op == "*") return IROp::Mul;
+        if (op == "/") return IROp::Div;
+        if (op == "==") return IROp::Eq;
+        if (op == "!=") return IROp::Ne;
+        if (op == "<") return IROp::Lt;
+        if (op == "<=") return IROp::Le;
+        if (op == ">") return IROp::Gt;
+        if (op == ">=") return IROp::Ge;
+        throw std::runtime_error("Unknown operator: " + op);
+    }
+
+    void statement(ASTNode* node) {
+        switch (node->kind) {
+            case NodeKind::Block:
+                for (ASTNode* child : node->children) {
+                    statement(child);
+                }
+                break;
+
+            case NodeKind::DeclarationInt:
+            case NodeKind::DeclarationChar:
+                // Uninitialized variables start out as zero on every entry
+                store(node, node->children.empty() ? emitValue(IROp::Const, 0) : expression(node->children[0]));
+                break;
+
+            case NodeKind::If: {
+                int32_t then = newBlock(), done = newBlock();
+                int32_t otherwise = node->children.size() > 2 ? newBlock() : done;
+                branch(expression(node->children[0]), then, otherwise);
+                current = then;
+                statement(node->children[1]);
+                jump(done);
+                if (otherwise != done) {
+                    current = otherwise;
+                    statement(node->children[2]);
+                    jump(done);
+                }
+                current = done;
+                break;
+            }
+
+            case NodeKind::While: {
+                int32_t test = newBlock(), body = newBlock(), done = newBlock();
+                jump(test);
+                current = test;
+                branch(expression(node->children[0]), body, done);
+                current = body;
+                statement(node->children[1]);
+                jump(test);
+                current = done;
+                break;
+            }
+
+            case NodeKind::For: {
+                int32_t test = newBlock(), body = newBlock(), update = newBlock(), done = newBlock();
+                statement(node->children[0]);
+                jump(test);
+                current = test;
+                branch(expression(node->children[1]), body, done);
+                current = body;
+                statement(node->children[3]);
+                jump(update);
+                current = update;
+                statement(node->children[2]);
+                jump(test);
+                current = done;
+                break;
+            }
+
+            case NodeKind::Return:
+                emit(IROp::Return, -1, node->children.empty() ? emitValue(IROp::Const, 0) : expression(node->children[0]));
+                current = newBlock();
+                break;
+
+            case NodeKind::Include:
+            case NodeKind::Unknown:
+                break;
+
+            default:
+                expression(node);
+                break;
+        }
+    }
+
+public:
+    IRLowering(ASTNode* program, IRFunction& function) : program(program), function(function) {}
+
+    void lower(ASTNode* target, bool runGlobalInitializers) {
+        function.name = target->value;
+        function.frameSize = target->frameSize;
+        function.localNames.assign(target->frameSize, "");
+        function.valueSlots.resize(target->frameSize);
+        for (int32_t slot = 0; slot < target->frameSize; ++slot) function.valueSlots[slot] = slot;
+        current = newBlock();
+        if (runGlobalInitializers) {
+            for (ASTNode* child : program->children) {
+                if (child->kind == NodeKind::DeclarationInt || child->kind == NodeKind::DeclarationChar) {
+                    statement(child);
+                }
+            }
+        }
+        if (target->children.size() > 1) {
+            statement(target->children[1]);
+        }
+        // Falling off the end returns 0
+        emit(IROp::Return, -1, emitValue(IROp::Const, 0));
+        packIR(function, draft);
+    }
+};
+
+// Lowers every FUNCTION of a resolved PROGRAM; the last main runs, after the
+// global initializers it starts with
+IRProgram lowerToIR(ASTNode* program) {
+    ASTNode* mainFunction = findMainFunction(program);
+    IRProgram ir;
+    ir.globalCount = program->frameSize;
+    for (ASTNode* child : program->children) {
+        if (child->kind != NodeKind::Function) continue;
+        if (child == mainFunction) ir.mainIndex = static_cast<int32_t>(ir.functions.size());
+        ir.functions.emplace_back();
+        IRLowering lowering(program, ir.functions.back());
+        lowering.lower(child, child == mainFunction);
+    }
+    return ir;
+}
+
+std::string irValueName(const IRFunction& function, int32_t value) {
+    if (value < 0) return "?";
+    int32_t slot = function.valueSlots[value];
+    if (slot < 0) return "%" + std::to_string(value);
+    const std::string& name = function.localNames[slot];
+    return "%" + (name.empty() ? "slot" + std::to_string(slot) : name) + "." + std::to_string(value);
+}
+
+void printIRInstr(const IRFunction& function, const IRInstr& instr, std::ostream& out) {
+    if (instr.dest >= 0) out << irValueName(function, instr.dest) << " = ";
+    switch (instr.op) {
+        case IROp::Const:
+            out << "const " << instr.a;
+            break;
+        case IROp::LoadGlobal:
+            out << "load @" << instr.a;
+            break;
+        case IROp::StoreGlobal:
+            out << "store @" << instr.a << ", " << irValueName(function, instr.b);
+            break;
+        case IROp::Phi:
+            out << "phi";
+            for (int32_t i = 0; i < instr.b; ++i) {
+                const IRPhiArg& arg = function.phiArgs[instr.a + i];
+                out << (i ? ", " : " ") << "[b" << arg.block << ": " << irValueName(function, arg.value) << "]";
+            }
+            break;
+        default: {
+            std::string name = irOpName(instr.op);
+            name[0] = static_cast<char>(name[0] - 'A' + 'a');
+            out << name;
+            bool first = true;
+            forEachIRUse(instr, [&](int32_t value) {
+                out << (first ? " " : ", ") << irValueName(function, value);
+                first = false;
+            });
+            break;
+        }
+    }
+}
+
+void printIRFunction(const IRFunction& function, std::ostream& out) {
+    out << "function " << function.name << " (" << function.blocks.size() << " blocks, " << function.code.size()
+        << " instructions, " << function.valueCount() << " values)\n";
+    for (size_t b = 0; b < function.blocks.size(); ++b) {
+        const IRBlock& block = function.blocks[b];
+        out << "b" << b << ":";
+        if (block.predCount) {
+            out << "  ; preds";
+            for (uint32_t i = 0; i < block.predCount; ++i) out << " b" << function.predsOf(static_cast<int32_t>(b))[i];
+        }
+        out << "\n";
+        for (uint32_t i = block.begin; i < block.end; ++i) {
+            const IRInstr& instr = function.code[i];
+            out << "    ";
+            printIRInstr(function, instr, out);
+            if (instr.op == IROp::Jump) out << " b" << block.succ[0];
+            if (instr.op == IROp::Branch) out << ", b" << block.succ[0] << ", b" << block.succ[1];
+            out << "\n";
+        }
+    }
+}
+
+void printIR(const IRProgram& program, std::ostream& out) {
+    for (size_t i = 0; i < program.functions.size(); ++i) {
+        if (i) out << "\n";
+        printIRFunction(program.functions[i], out);
+    }
+}
+
+// Executes IR directly, to check lowering and the IR passes against the
+// other engines. Phis read their operands for the edge just taken, all at
+// once on entry to the block.
+class IRInterpreter {
+private:
+    const IRProgram& program;
+    std::vector<int32_t> globals;
+    uint64_t executed = 0;
+
+public:
+    explicit IRInterpreter(const IRProgram& program)
+        : program(program), globals(std::max<int32_t>(program.globalCount, 1), 0) {}
+
+    uint64_t instructionsExecuted() const { return executed; }
+
+    int32_t call(const IRFunction& function) {
+        std::vector<int32_t> values(function.valueCount(), 0);
+        std::vector<int32_t> incoming;
+        int32_t previous = -1;
+        int32_t b = 0;
+        for (;;) {
+            const IRBlock& block = function.blocks[b];
+            executed += block.end - block.begin;
+            uint32_t i = block.begin;
+            incoming.clear();
+            for (uint32_t p = i; p < block.end && function.code[p].op == IROp::Phi; ++p) {
+                const IRInstr& phi = function.code[p];
+                int32_t value = 0;
+                for (int32_t k = 0; k < phi.b; ++k) {
+                    const IRPhiArg& arg = function.phiArgs[phi.a + k];
+                    if (arg.block == previous) value = values[arg.value];
+                }
+                incoming.push_back(value);
+            }
+            for (int32_t value : incoming) values[function.code[i++].dest] = value;
+            for (; i < block.end; ++i) {
+                const IRInstr& instr = function.code[i];
+                switch (instr.op) {
+                    case IROp::Nop:
+                    case IROp::Phi:
+                        break;
+                    case IROp::Const:
+                        values[instr.dest] = instr.a;
+                        break;
+                    case IROp::LoadGlobal:
+                        values[instr.dest] = globals[instr.a];
+                        break;
+                    case IROp::StoreGlobal:
+                        globals[instr.a] = values[instr.b];
+                        break;
+                    case IROp::StringValue:
+                        throw std::runtime_error("String values are not supported at runtime");
+                    case IROp::Jump:
+                        previous = b;
+                        b = block.succ[0];
+                        break;
+                    case IROp::Branch:
+                        previous = b;
+                        b = values[instr.a] != 0 ? block.succ[0] : block.succ[1];
+                        break;
+                    case IROp::Return:
+                        return values[instr.a];
+                    default: {
+                        int32_t result;
+                        int32_t right = isIRBinary(instr.op) ? values[instr.b] : 0;
+                        if (!evalIROp(instr.op, values[instr.a], right, result)) {
+                            throw std::runtime_error("Division by zero");
+                        }
+                        values[instr.dest] = result;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    int32_t run() {
+        if (program.mainIndex < 0) {
+            throw std::runtime_error("No main function to run");
+        }
+        return call(program.functions[program.mainIndex]);
+    }
+};
+
+// Runs main of an IR program and returns its exit code
+int32_t runIR(const IRProgram& program, uint64_t* instructionsExecuted = nullptr) {
+    IRInterpreter interpreter(program);
+    int32_t result = interpreter.run();
+    if (instructionsExecuted) *instructionsExecuted = interpreter.instructionsExecuted();
+    return result;
+}
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef IROPT_H
+#define IROPT_H
+
+#include <cstddef>
+#include <ostream>
+#include "ir.h"
+#include "ssa.h"
+#include "gvn.h"
+#include "licm.h"
+#include "indvars.h"
+
+struct IROptStats {
+    SSAStats ssa;
+    GVNStats gvn;
+    LICMStats licm;
+    IVStats iv;
+    size_t instructionsBefore = 0;
+    size_t instructionsAfter = 0;
+};
+
+// Puts every function into SSA form and runs the IR optimizations over it
+IROptStats optimizeIR(IRProgram& program) {
+    IROptStats stats;
+    for (IRFunction& function : program.functions) {
+        stats.instructionsBefore += function.code.size();
+        convertToSSA(function, stats.ssa);
+        ConstantPropagation(function).run(stats.ssa);
+        ValueNumbering(function).run(stats.gvn);
+        hoistLoopInvariants(function, stats.licm);
+        InductionVariables(function).run(stats.iv);
+        stats.ssa.deadInstructions += eliminateDeadIR(function);
+        stats.instructionsAfter += function.code.size();
+    }
+    return stats;
+}
+
+void printIROptStats(const IROptStats& stats, std::ostream& out) {
+    out << "  Phi nodes inserted: " << stats.ssa.phis << "\n";
+    out << "  Values proved constant: " << stats.ssa.constants << "\n";
+    out << "  Branches folded: " << stats.ssa.branchesFolded << "\n";
+    out << "  Unreachable blocks removed: " << stats.ssa.blocksRemoved << "\n";
+    out << "  Redundant expressions removed: " << stats.gvn.redundant << "\n";
+    out << "  Copies propagated: " << stats.gvn.copies << "\n";
+    out << "  Redundant phis removed: " << stats.gvn.phis << "\n";
+    out << "  Loops found: " << stats.licm.loops << "\n";
+    out << "  Loop preheaders inserted: " << stats.licm.preheaders << "\n";
+    out << "  Loop-invariant instructions hoisted: " << stats.licm.hoisted << "\n";
+    out << "  Induction variables found: " << stats.iv.inductionVariables << "\n";
+    out << "  Multiplications strength-reduced: " << stats.iv.reduced << "\n";
+    out << "  Loop tests replaced: " << stats.iv.testsReplaced << "\n";
+    out << "  Divisions by constants rewritten: " << stats.iv.divisions << "\n";
+    out << "  Dead instructions removed: " << stats.ssa.deadInstructions << "\n";
+    out << "  IR instructions: " << stats.instructionsBefore << " -> " << stats.instructionsAfter << "\n";
+}
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+#include "parser.h" // For ASTNode
+#include "perfmap.h"
+#include "x86.h"
+#include "x86encode.h"
+
+// Owns mappings of generated machine code. Each block is written while
+// mapped read-write and then switched to read-execute, so no page is ever
+// writable and executable at once.
+class ExecutableMemory {
+private:
+    std::vector<std::pair<void*, size_t>> mappings;
+
+public:
+    ExecutableMemory() = default;
+    ExecutableMemory(const ExecutableMemory&) = delete;
+    ExecutableMemory& operator=(const ExecutableMemory&) = delete;
+
+    ~ExecutableMemory() {
+        for (const auto& [memory, size] : mappings) ::munmap(memory, size);
+    }
+
+    // Copies code into a fresh executable mapping and returns its address
+    const uint8_t* install(const std::vector<uint8_t>& code) {
+        size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        size_t size = (std::max<size_t>(code.size(), 1) + page - 1) / page * page;
+        void* memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            throw std::runtime_error("Could not map JIT memory");
+        }
+        mappings.push_back({memory, size});
+        std::memcpy(memory, code.data(), code.size());
+        if (::mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+            throw std::runtime_error("Could not make JIT memory executable");
+        }
+        return static_cast<const uint8_t*>(memory);
+    }
+};
+
+// Throws the error a compiled function reported through its status word
+void checkX86Status(int32_t status) {
+    if (status == kX86DivideByZero) throw std::runtime_error("Division by zero");
+    if (status == kX86StringValue) throw std::runtime_error("String values are not supported at runtime");
+}
+
+// Compiles every FUNCTION of a resolved program to x86-64 in one executable
+// buffer and calls main in process
+class JitProgram {
+public:
+    using Entry = int32_t (*)(int32_t* globals, int32_t* status);
+
+    struct Function {
+        std::string name;
+        size_t offset;
+        size_t size;
+    };
+
+private:
+    ExecutableMemory memory;
+    const uint8_t* base = nullptr;
+    std::vector<Function> functions;
+    int32_t globalCount = 0;
+    PerfMap* perfMap;
+
+public:
+    explicit JitProgram(PerfMap* perfMap = nullptr) : perfMap(perfMap) {}
+
+    void compile(ASTNode* program) {
+        findMainFunction(program); // Fails the same way as the other engines
+        globalCount = program->frameSize;
+        std::vector<uint8_t> image;
+        std::vector<std::string> symbols;
+        for (ASTNode* child : program->children) {
+            if (child->kind != NodeKind::Function) continue;
+            std::vector<uint8_t> code = encodeX86(compileX86(program, child)).bytes;
+            while (image.size() % 16) image.push_back(0xCC);
+            functions.push_back({child->value, image.size(), code.size()});
+            if (perfMap) symbols.push_back(perfMap->symbolName(child));
+            image.insert(image.end(), code.begin(), code.end());
+        }
+        base = memory.install(image);
+        for (size_t i = 0; i < symbols.size(); ++i) {
+            perfMap->add(symbols[i], address(functions[i]), functions[i].size);
+        }
+    }
+
+    const std::vector<Function>& compiledFunctions() const { return functions; }
+
+    const uint8_t* address(const Function& function) const { return base + function.offset; }
+
+    // Runs the global initializers, then main; returns main's exit code
+    int32_t run() const {
+        for (const Function& function : functions) {
+            if (function.name != "main") continue;
+            std::vector<int32_t> globals(std::max<int32_t>(globalCount, 1), 0);
+            int32_t status = 0;
+            Entry entry = reinterpret_cast<Entry>(const_cast<uint8_t*>(address(function)));
+            int32_t result = entry(globals.data(), &status);
+            checkX86Status(status);
+            return result;
+        }
+        throw std::runtime_error("No main function to run");
+    }
+};
+
+// JIT-compiles a resolved PROGRAM, runs it and returns main's exit code
+int32_t runJit(ASTNode* program, PerfMap* perfMap = nullptr) {
+    JitProgram jit(perfMap);
+    jit.compile(program);
+    return jit.run();
+}
+
+#endif
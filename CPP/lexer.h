@@ -10,8 +10,9 @@ class Token {
 public:
     std::string type;
     std::string value;
+    int line = 0; // 1-based source line, 0 if unknown
 
-    Token(const std::string& t, const std::string& v) : type(t), value(v) {}
+    Token(const std::string& t, const std::string& v, int l = 0) : type(t), value(v), line(l) {}
 };
 
 // Lexer class
@@ -20,6 +21,15 @@ private:
     std::string input;
     size_t pos;
     std::unordered_map<std::string, std::string> keywords;
+    size_t linePos = 0; // Newlines before linePos are counted in line
+    int line = 1;
+
+    int lineAt(size_t position) {
+        for (; linePos < position && linePos < input.length(); ++linePos) {
+            if (input[linePos] == '\n') line++;
+        }
+        return line;
+    }
 
     bool isAlpha(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
     bool isDigit(char c) { return c >= '0' && c <= '9'; }
@@ -78,11 +88,16 @@ public:
 
     std::vector<Token> tokenize() {
         std::vector<Token> tokens;
+        size_t numbered = 0; // Tokens before this already carry their line
+        int tokenLine = 1;
 
         while (pos < input.length()) {
+            // Everything pushed by the last iteration started on tokenLine
+            for (; numbered < tokens.size(); ++numbered) tokens[numbered].line = tokenLine;
             skipCommentsAndEmptyLines();
 
             if (pos >= input.length()) break;
+            tokenLine = lineAt(pos);
 
             char current = input[pos];
 
@@ -233,6 +248,7 @@ public:
                 default: pos++; // Skip unrecognized characters
             }
         }
+        for (; numbered < tokens.size(); ++numbered) tokens[numbered].line = tokenLine;
 
         return tokens;
     }
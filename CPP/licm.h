@@ -0,0 +1,197 @@
+#ifndef LICM_H
+#define LICM_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ir.h"
+#include "ssa.h"
+
+// A natural loop: the header, every block that can reach one of its back
+// edges without passing through the header, and the single block outside
+// the loop that enters it
+struct IRLoop {
+    int32_t header = -1;
+    int32_t preheader = -1;
+    std::vector<int32_t> blocks; // Including the header, in reverse postorder
+};
+
+// Finds the natural loops of a function from its back edges, edges whose
+// target dominates their source. Loops sharing a header are one loop.
+// preheader is only set when the header has exactly one predecessor
+// outside the loop.
+std::vector<IRLoop> findLoops(const IRFunction& function, const DominatorTree& tree) {
+    std::vector<IRLoop> loops;
+    std::vector<int32_t> member(function.blocks.size(), -1);
+    std::vector<int32_t> worklist;
+    for (int32_t header : tree.order) {
+        const int32_t* preds = function.predsOf(header);
+        uint32_t predCount = function.blocks[header].predCount;
+        IRLoop loop;
+        loop.header = header;
+        int outside = 0;
+        int32_t id = static_cast<int32_t>(loops.size());
+        for (uint32_t p = 0; p < predCount; ++p) {
+            if (tree.dominates(header, preds[p])) {
+                worklist.push_back(preds[p]);
+            } else {
+                outside++;
+                loop.preheader = preds[p];
+            }
+        }
+        if (worklist.empty()) continue;
+        if (outside != 1) loop.preheader = -1;
+        member[header] = id;
+        loop.blocks.push_back(header);
+        while (!worklist.empty()) {
+            int32_t b = worklist.back();
+            worklist.pop_back();
+            if (member[b] == id || !tree.reachable(b)) continue;
+            member[b] = id;
+            loop.blocks.push_back(b);
+            const int32_t* bPreds = function.predsOf(b);
+            for (uint32_t p = 0; p < function.blocks[b].predCount; ++p) worklist.push_back(bPreds[p]);
+        }
+        std::sort(loop.blocks.begin(), loop.blocks.end(),
+                  [&](int32_t x, int32_t y) { return tree.orderIndex[x] < tree.orderIndex[y]; });
+        loops.push_back(std::move(loop));
+    }
+    return loops;
+}
+
+struct LICMStats {
+    int loops = 0;      // Natural loops found
+    int preheaders = 0; // Blocks added so a loop has one way in
+    int hoisted = 0;    // Instructions moved out of a loop
+};
+
+// Gives every loop header a preheader: a block that only jumps to the
+// header and is its only predecessor outside the loop. Phi operands from
+// the outside predecessors are merged there first.
+void insertPreheaders(IRFunction& function, LICMStats& stats) {
+    DominatorTree tree = buildDominators(function);
+    IRDraft draft = unpackIR(function);
+    std::vector<int32_t> outside;
+    for (int32_t header : tree.order) {
+        const int32_t* preds = function.predsOf(header);
+        outside.clear();
+        bool isLoop = false;
+        for (uint32_t p = 0; p < function.blocks[header].predCount; ++p) {
+            if (tree.dominates(header, preds[p])) {
+                isLoop = true;
+            } else {
+                outside.push_back(preds[p]);
+            }
+        }
+        // The entry cannot get a block in front of it
+        if (!isLoop || header == 0 || outside.empty()) continue;
+        if (outside.size() == 1 && draft.blocks[outside[0]].succ[1] < 0) continue;
+
+        int32_t preheader = static_cast<int32_t>(draft.blocks.size());
+        draft.blocks.emplace_back();
+        draft.blocks[preheader].succ[0] = header;
+        for (int32_t pred : outside) {
+            for (int32_t& succ : draft.blocks[pred].succ) {
+                if (succ == header) succ = preheader;
+            }
+        }
+        std::vector<IRInstr> phis;
+        for (IRInstr& instr : draft.blocks[header].code) {
+            if (instr.op != IROp::Phi) continue;
+            std::vector<IRPhiArg> inner, entering;
+            for (const IRPhiArg& arg : draft.phis[instr.a]) {
+                bool fromOutside = std::find(outside.begin(), outside.end(), arg.block) != outside.end();
+                (fromOutside ? entering : inner).push_back(arg);
+            }
+            if (entering.empty()) continue;
+            int32_t value = entering[0].value;
+            for (const IRPhiArg& arg : entering) {
+                if (arg.value != value) value = -1;
+            }
+            if (value < 0) {
+                value = function.newValue(function.valueSlots[instr.dest]);
+                phis.push_back({IROp::Phi, value, static_cast<int32_t>(draft.phis.size()), 0});
+                draft.phis.push_back(entering);
+            }
+            inner.push_back({preheader, value});
+            draft.phis[instr.a] = inner;
+        }
+        std::vector<IRInstr>& code = draft.blocks[preheader].code;
+        code = phis;
+        code.push_back({IROp::Jump, -1, -1, -1});
+        stats.preheaders++;
+    }
+    if (stats.preheaders) packIR(function, draft);
+}
+
+// Loop-invariant code motion. Loops are visited innermost first, and an
+// instruction moves to the preheader when it is safe to run on every
+// entry to the loop and its operands are all defined outside it. Only
+// pure instructions move, so a loop that runs no iterations just computes
+// a value nobody reads: division only by a nonzero constant, and a global
+// load only when the loop stores nothing to that global. Locals need no
+// such care, since SSA gives every assignment in the loop a new value.
+void hoistLoopInvariants(IRFunction& function, LICMStats& stats) {
+    insertPreheaders(function, stats);
+    DominatorTree tree = buildDominators(function);
+    std::vector<IRLoop> loops = findLoops(function, tree);
+    stats.loops += static_cast<int>(loops.size());
+    std::sort(loops.begin(), loops.end(),
+              [](const IRLoop& x, const IRLoop& y) { return x.blocks.size() < y.blocks.size(); });
+
+    IRDraft draft = unpackIR(function);
+    std::vector<int32_t> defBlock(function.valueCount(), -1);
+    std::vector<uint8_t> nonzeroConstant(function.valueCount(), 0);
+    for (size_t b = 0; b < draft.blocks.size(); ++b) {
+        for (const IRInstr& instr : draft.blocks[b].code) {
+            if (instr.dest >= 0) defBlock[instr.dest] = static_cast<int32_t>(b);
+            if (instr.op == IROp::Const && instr.a != 0) nonzeroConstant[instr.dest] = 1;
+        }
+    }
+    std::vector<int32_t> inLoop(draft.blocks.size(), -1);
+    std::vector<int32_t> storedIn; // By global: the last loop seen storing to it
+    std::vector<IRInstr> moved;
+    bool changed = false;
+    for (size_t id = 0; id < loops.size(); ++id) {
+        const IRLoop& loop = loops[id];
+        if (loop.preheader < 0) continue;
+        int32_t stamp = static_cast<int32_t>(id);
+        for (int32_t b : loop.blocks) {
+            inLoop[b] = stamp;
+            for (const IRInstr& instr : draft.blocks[b].code) {
+                if (instr.op != IROp::StoreGlobal) continue;
+                if (instr.a >= static_cast<int32_t>(storedIn.size())) storedIn.resize(instr.a + 1, -1);
+                storedIn[instr.a] = stamp;
+            }
+        }
+        auto invariant = [&](int32_t value) { return defBlock[value] < 0 || inLoop[defBlock[value]] != stamp; };
+        moved.clear();
+        for (int32_t b : loop.blocks) {
+            for (IRInstr& instr : draft.blocks[b].code) {
+                bool movable = instr.op == IROp::Const || instr.op == IROp::Copy || instr.op == IROp::Neg ||
+                               instr.op == IROp::Not || (isIRBinary(instr.op) && instr.op != IROp::Div);
+                if (instr.op == IROp::Div) {
+                    movable = nonzeroConstant[instr.b];
+                } else if (instr.op == IROp::LoadGlobal) {
+                    movable = instr.a >= static_cast<int32_t>(storedIn.size()) || storedIn[instr.a] != stamp;
+                }
+                if (!movable) continue;
+                bool operandsOutside = true;
+                forEachIRUse(instr, [&](int32_t v) { operandsOutside = operandsOutside && invariant(v); });
+                if (!operandsOutside) continue;
+                moved.push_back(instr);
+                defBlock[instr.dest] = loop.preheader;
+                instr = IRInstr();
+            }
+        }
+        if (moved.empty()) continue;
+        std::vector<IRInstr>& code = draft.blocks[loop.preheader].code;
+        code.insert(code.end() - 1, moved.begin(), moved.end());
+        stats.hoisted += static_cast<int>(moved.size());
+        changed = true;
+    }
+    if (changed) packIR(function, draft);
+}
+
+#endif
@@ -2,9 +2,35 @@
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+#include <memory>
 #include "lexer.h"
 #include "parser.h"
+#include "visitor.h"
 #include "semantic.h"
+#include "parallel_semantic.h"
+#include "resolver.h"
+#include "dataflow.h"
+#include "constfold.h"
+#include "deadcode.h"
+#include "interpreter.h"
+#include "bytecode.h"
+#include "vm.h"
+#include "superinstructions.h"
+#include "module.h"
+#include "regcode.h"
+#include "regvm.h"
+#include "closure.h"
+#include "x86asm.h"
+#include "elf64.h"
+#include "jit.h"
+#include "tiered.h"
+#include "perfmap.h"
+#include "cgen.h"
+#include "ir.h"
+#include "iropt.h"
 
 std::string readFile(const std::string& filepath) {
     std::ifstream file(filepath);
@@ -16,42 +42,340 @@ std::string readFile(const std::string& filepath) {
     return buffer.str();
 }
 
-// Helper function to count specific node types in the AST
-int countNodeTypes(ASTNode* node, const std::string& type) {
-    if (!node) return 0;
-    
-    int count = (node->type == type) ? 1 : 0;
-    
-    for (ASTNode* child : node->children) {
-        count += countNodeTypes(child, type);
-    }
-    
-    return count;
-}
-
 // Helper to print summary of recognized constructs
 void printSummary(ASTNode* ast) {
+    NodeCounter counter;
+    counter.visit(ast);
+
     std::cout << "\nCompilation Summary:\n";
     std::cout << "-------------------\n";
-    std::cout << "Includes: " << countNodeTypes(ast, "INCLUDE") << "\n";
-    std::cout << "Functions: " << countNodeTypes(ast, "FUNCTION") << "\n";
+    std::cout << "Includes: " << counter.count(NodeKind::Include) << "\n";
+    std::cout << "Functions: " << counter.count(NodeKind::Function) << "\n";
     std::cout << "Variable Declarations: " 
-              << countNodeTypes(ast, "DECLARATION_INT") + countNodeTypes(ast, "DECLARATION_CHAR_TYPE") << "\n";
-    std::cout << "Assignments: " << countNodeTypes(ast, "ASSIGNMENT") << "\n";
-    std::cout << "If Statements: " << countNodeTypes(ast, "IF") << "\n";
-    std::cout << "While Loops: " << countNodeTypes(ast, "WHILE") << "\n";
-    std::cout << "For Loops: " << countNodeTypes(ast, "FOR") << "\n";
-    std::cout << "Return Statements: " << countNodeTypes(ast, "RETURN") << "\n";
+              << counter.count(NodeKind::DeclarationInt) + counter.count(NodeKind::DeclarationChar) << "\n";
+    std::cout << "Assignments: " << counter.count(NodeKind::Assignment) << "\n";
+    std::cout << "If Statements: " << counter.count(NodeKind::If) << "\n";
+    std::cout << "While Loops: " << counter.count(NodeKind::While) << "\n";
+    std::cout << "For Loops: " << counter.count(NodeKind::For) << "\n";
+    std::cout << "Return Statements: " << counter.count(NodeKind::Return) << "\n";
     std::cout << "-------------------\n";
 }
 
+// Command-line options
+struct CompilerOptions {
+    std::string inputFile;
+    int semanticJobs = -1; // -1: sequential analysis, 0: one thread per core
+    bool optimize = true;
+    bool printOptimizedAst = false;
+    bool hashConsing = false;
+    bool watch = false;
+    std::string runEngine; // Empty: compile only
+    bool printBytecode = false;
+    bool fuse = true;         // Superinstructions in stack bytecode
+    bool profileOps = false;  // Count executed opcode sequences on the stack VM
+    std::string profileFile;  // Accumulates counts across runs when set
+    std::string emitModule;   // Write the compiled stack bytecode here
+    std::string loadModule;   // Run this compiled module instead of a source file
+    bool emitAsm = false;
+    std::string asmFile;      // Empty: print the assembly
+    std::string objectFile;   // Write main as a relocatable ELF object here
+    std::string executableFile; // Write a static ELF executable here
+    uint32_t tierThreshold = 1000; // Back edges before a loop is compiled (--run=tiered)
+    bool perfMap = false;      // Name JIT code in /tmp/perf-<pid>.map
+    std::string jitdumpDir;    // Write jit-<pid>.dump here when set
+    bool emitC = false;
+    std::string cFile;         // Empty: print the C source
+    std::string cExecutableFile; // Build an executable with the C compiler here
+    std::string cOptimization = "2"; // -O level for the C compiler
+    bool printIR = false;
+};
+
+bool isRunEngine(const std::string& name) {
+    return name == "ast" || name == "closure" || name == "vm" || name == "reg" || name == "native" || name == "jit" ||
+           name == "tiered" || name == "c" || name == "ir";
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options] <input_file.cpp>\n";
+    std::cerr << "Options:\n";
+    std::cerr << "  --jobs=N    Analyze function bodies on N threads, at most one per core (0: one per core)\n";
+    std::cerr << "  --no-opt    Skip AST optimizations\n";
+    std::cerr << "  --print-opt Print the AST again after optimization\n";
+    std::cerr << "  --hash-cons Share identical side-effect-free expression subtrees\n";
+    std::cerr << "  --watch     Re-check the file whenever it changes, reusing unchanged functions\n";
+    std::cerr << "  --run[=E]   Execute main with engine E (ast, closure, vm, reg, native, jit, tiered, c, ir)\n";
+    std::cerr << "  --jit       Same as --run=jit: compile to x86-64 in memory and call main\n";
+    std::cerr << "  --tier-threshold=N Loop back edges before --run=tiered compiles a loop (default 1000)\n";
+    std::cerr << "  --perf-map  Name JIT-compiled code for perf in /tmp/perf-<pid>.map\n";
+    std::cerr << "  --jitdump[=DIR] Write a jitdump file for perf inject (default: current directory)\n";
+    std::cerr << "  --print-ir  Print the three-address IR and control-flow graph of every function\n";
+    std::cerr << "  --print-bytecode Print the bytecode compiled for main (register code with --run=reg)\n";
+    std::cerr << "  --no-fuse   Do not fuse stack bytecode into superinstructions\n";
+    std::cerr << "  --profile-ops[=FILE] Run on the stack VM counting opcode pairs and triples,\n";
+    std::cerr << "              adding them to the totals in FILE\n";
+    std::cerr << "  --emit-module=FILE Save the compiled bytecode as a module file\n";
+    std::cerr << "  --load-module=FILE Run a saved module without compiling (no input file)\n";
+    std::cerr << "  --emit-asm[=FILE] Print (or save) the x86-64 assembly compiled for main\n";
+    std::cerr << "  --emit-obj=FILE Write the machine code as an ELF object defining main\n";
+    std::cerr << "  --emit-exe=FILE Write the machine code as a static ELF executable\n";
+    std::cerr << "  --emit-c[=FILE] Print (or save) the program translated to C\n";
+    std::cerr << "  --emit-c-exe=FILE Build an executable from the C translation with $CC or cc\n";
+    std::cerr << "  --c-opt=L   Optimization level for the C compiler (0-3 or s, default 2)\n";
+}
+
+// Parses a decimal option value. Digits only: std::stoul alone would accept
+// "4x", " 4" and "-1" (which wraps)
+bool parseCount(const std::string& text, unsigned long max, unsigned long& value) {
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) return false;
+    try {
+        value = std::stoul(text);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return value <= max;
+}
+
+bool parseOptions(int argc, char* argv[], CompilerOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--jobs=", 0) == 0) {
+            unsigned long jobs;
+            if (!parseCount(arg.substr(7), INT32_MAX, jobs)) return false;
+            options.semanticJobs = static_cast<int>(jobs);
+        } else if (arg == "--no-opt") {
+            options.optimize = false;
+        } else if (arg == "--print-opt") {
+            options.printOptimizedAst = true;
+        } else if (arg == "--hash-cons") {
+            options.hashConsing = true;
+        } else if (arg == "--watch") {
+            options.watch = true;
+        } else if (arg == "--run") {
+            options.runEngine = "ast";
+        } else if (arg.rfind("--run=", 0) == 0) {
+            options.runEngine = arg.substr(6);
+            if (!isRunEngine(options.runEngine)) return false;
+        } else if (arg.rfind("--tier-threshold=", 0) == 0) {
+            unsigned long threshold;
+            if (!parseCount(arg.substr(17), UINT32_MAX, threshold) || threshold == 0) return false;
+            options.tierThreshold = static_cast<uint32_t>(threshold);
+        } else if (arg == "--jit") {
+            options.runEngine = "jit";
+        } else if (arg == "--perf-map") {
+            options.perfMap = true;
+        } else if (arg == "--jitdump") {
+            options.jitdumpDir = ".";
+        } else if (arg.rfind("--jitdump=", 0) == 0) {
+            options.jitdumpDir = arg.substr(10);
+            if (options.jitdumpDir.empty()) return false;
+        } else if (arg == "--print-ir") {
+            options.printIR = true;
+        } else if (arg == "--print-bytecode") {
+            options.printBytecode = true;
+        } else if (arg == "--no-fuse") {
+            options.fuse = false;
+        } else if (arg == "--profile-ops") {
+            options.profileOps = true;
+        } else if (arg.rfind("--profile-ops=", 0) == 0) {
+            options.profileOps = true;
+            options.profileFile = arg.substr(14);
+        } else if (arg.rfind("--emit-module=", 0) == 0) {
+            options.emitModule = arg.substr(14);
+        } else if (arg.rfind("--load-module=", 0) == 0) {
+            options.loadModule = arg.substr(14);
+        } else if (arg == "--emit-asm") {
+            options.emitAsm = true;
+        } else if (arg.rfind("--emit-asm=", 0) == 0) {
+            options.emitAsm = true;
+            options.asmFile = arg.substr(11);
+        } else if (arg.rfind("--emit-obj=", 0) == 0) {
+            options.objectFile = arg.substr(11);
+        } else if (arg.rfind("--emit-exe=", 0) == 0) {
+            options.executableFile = arg.substr(11);
+        } else if (arg == "--emit-c") {
+            options.emitC = true;
+        } else if (arg.rfind("--emit-c=", 0) == 0) {
+            options.emitC = true;
+            options.cFile = arg.substr(9);
+        } else if (arg.rfind("--emit-c-exe=", 0) == 0) {
+            options.cExecutableFile = arg.substr(13);
+        } else if (arg.rfind("--c-opt=", 0) == 0) {
+            options.cOptimization = arg.substr(8);
+            const std::string& level = options.cOptimization;
+            if (level != "0" && level != "1" && level != "2" && level != "3" && level != "s") return false;
+        } else if (arg.rfind("--", 0) == 0 || !options.inputFile.empty()) {
+            return false;
+        } else {
+            options.inputFile = arg;
+        }
+    }
+    if (options.profileOps) {
+        // Profiling counts stack VM instructions
+        if (options.runEngine.empty()) options.runEngine = "vm";
+        if (options.runEngine != "vm") return false;
+    }
+    if (options.perfMap || !options.jitdumpDir.empty()) {
+        // Only the in-process engines install code perf needs to be told about
+        if (options.runEngine.empty()) options.runEngine = "jit";
+        if (options.runEngine != "jit" && options.runEngine != "tiered") return false;
+    }
+    if (!options.loadModule.empty()) {
+        return options.inputFile.empty();
+    }
+    return !options.inputFile.empty();
+}
+
+// Maps a saved module, validates it and runs it; the front end never runs
+int runModuleFile(const std::string& path) {
+    std::unique_ptr<MappedModule> module;
+    double loadTime = 0;
+    try {
+        auto start = std::chrono::steady_clock::now();
+        module = std::make_unique<MappedModule>(path);
+        loadTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Module Error: " << e.what() << "\n";
+        return 1;
+    }
+    std::cout << "Loaded module: " << path << " (" << module->header->codeWords << " words, "
+              << module->header->constantCount << " constants, source hash " << std::hex
+              << module->header->sourceHash << std::dec << ")\n";
+    std::istringstream symbols(module->symbolDump());
+    for (std::string line; std::getline(symbols, line);) {
+        std::cout << "  " << line << "\n";
+    }
+
+    try {
+        auto start = std::chrono::steady_clock::now();
+        int32_t exitCode = module->run();
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "\nExecution Results (module):\n";
+        std::cout << "========================\n";
+        std::cout << "  Exit code: " << exitCode << "\n";
+        std::cout << "  Load time: " << std::fixed << std::setprecision(3) << loadTime << " ms\n";
+        std::cout << "  Time: " << elapsed << " ms\n" << std::defaultfloat;
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Runtime Error: " << e.what() << "\n";
+        return 1;
+    } catch (const std::exception& e) {
+        // Anything else is the module's fault, such as arrays too big to allocate
+        std::cerr << "Module Error: " << path << ": " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+// Compiles main to stack bytecode, fused into superinstructions unless
+// disabled
+BytecodeModule compileStackCode(ASTNode* ast, const CompilerOptions& options) {
+    BytecodeModule module = compileBytecode(ast);
+    if (options.fuse) {
+        fuseSuperinstructions(module);
+    }
+    return module;
+}
+
+// Counters the engines report after a run
+struct RunStats {
+    TierStats tiers;
+    uint64_t irInstructions = 0; // Executed by --run=ir
+};
+
+// Runs main with the chosen engine and returns its exit code
+int32_t runProgram(ASTNode* ast, const IRProgram* ir, const CompilerOptions& options, OpcodeProfile* profile,
+                   RunStats& stats) {
+    const std::string& engine = options.runEngine;
+    if (engine == "closure") {
+        return runClosures(ast);
+    }
+    if (engine == "vm") {
+        return runBytecode(compileStackCode(ast, options), profile);
+    }
+    if (engine == "reg") {
+        return runRegisterCode(compileRegisterCode(ast));
+    }
+    if (engine == "tiered" || engine == "jit") {
+        std::unique_ptr<PerfMap> perfMap;
+        if (options.perfMap || !options.jitdumpDir.empty()) {
+            std::string source = std::filesystem::path(options.inputFile).filename().string();
+            perfMap = std::make_unique<PerfMap>(source, options.perfMap, options.jitdumpDir);
+        }
+        if (engine == "tiered") {
+            return runTiered(ast, options.tierThreshold, stats.tiers, perfMap.get());
+        }
+        return runJit(ast, perfMap.get());
+    }
+    if (engine == "native") {
+        return runNative(compileX86(ast));
+    }
+    if (engine == "c") {
+        return runC(ast, options.cOptimization);
+    }
+    if (engine == "ir") {
+        return ir ? runIR(*ir, &stats.irInstructions) : runIR(lowerToIR(ast), &stats.irInstructions);
+    }
+    return interpretProgram(ast);
+}
+
+// Re-runs lexing, parsing and semantic analysis whenever the input file
+// changes. Function bodies unchanged since an earlier run, and whose globals
+// are unchanged, reuse their cached results. Runs until interrupted.
+int runWatchMode(const CompilerOptions& options) {
+    SemanticCache cache;
+    unsigned jobs = options.semanticJobs >= 0 ? options.semanticJobs : 1;
+    std::filesystem::file_time_type lastWrite;
+    bool first = true;
+
+    std::cout << "Watching " << options.inputFile << " (Ctrl-C to stop)\n";
+    while (true) {
+        std::error_code error;
+        auto writeTime = std::filesystem::last_write_time(options.inputFile, error);
+        if (!error && (first || writeTime != lastWrite)) {
+            first = false;
+            lastWrite = writeTime;
+            auto start = std::chrono::steady_clock::now();
+            ASTNode* ast = nullptr;
+            bool analyzed = false;
+            try {
+                Lexer lexer(readFile(options.inputFile));
+                Parser parser(lexer.tokenize(), options.hashConsing);
+                ast = parser.parse();
+                std::unordered_map<std::string, std::string> symbolTable;
+                analyzed = true;
+                parallelSemanticAnalysis(ast, symbolTable, jobs, &cache);
+                std::cout << "No errors";
+            } catch (const std::runtime_error& e) {
+                std::cout << "Error: " << e.what();
+            }
+            double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (analyzed) {
+                std::cout << " (" << cache.misses << " functions analyzed, " << cache.hits << " reused";
+            } else {
+                std::cout << " (";
+            }
+            std::cout << std::fixed << std::setprecision(2) << (analyzed ? ", " : "") << elapsed << " ms)\n"
+                      << std::defaultfloat << std::flush;
+            delete ast;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+}
+
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <input_file.cpp>\n";
+    CompilerOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
         return 1;
     }
 
-    std::string filepath = argv[1];
+    if (options.watch) {
+        return runWatchMode(options);
+    }
+    if (!options.loadModule.empty()) {
+        return runModuleFile(options.loadModule);
+    }
+
+    std::string filepath = options.inputFile;
     std::string source;
 
     try {
@@ -99,11 +423,15 @@ int main(int argc, char* argv[]) {
 
     ASTNode* ast = nullptr;
     try {
-        Parser parser(tokens);
+        Parser parser(tokens, options.hashConsing);
         ast = parser.parse();
         std::cout << "Syntax Analysis Results:\n";
         std::cout << "======================\n";
         ast->print();
+        if (ast->pool) {
+            std::cout << "Hash-consing: " << ast->pool->created << " shared expression nodes, "
+                      << ast->pool->reused << " reuses\n";
+        }
         
         // Print summary of constructs found
         printSummary(ast);
@@ -117,7 +445,11 @@ int main(int argc, char* argv[]) {
 
     std::unordered_map<std::string, std::string> symbolTable;
     try {
-        semanticAnalysis(ast, symbolTable);
+        if (options.semanticJobs >= 0) {
+            parallelSemanticAnalysis(ast, symbolTable, options.semanticJobs);
+        } else {
+            semanticAnalysis(ast, symbolTable);
+        }
         std::cout << "Semantic Analysis Results:\n";
         std::cout << "========================\n";
         
@@ -135,7 +467,202 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    try {
+        resolveNames(ast);
+        std::cout << "\nName Resolution Results:\n";
+        std::cout << "========================\n";
+        std::cout << "  " << std::setw(15) << std::left << "<globals>" << ": " << ast->frameSize << " slots\n";
+        for (ASTNode* child : ast->children) {
+            if (child->kind == NodeKind::Function) {
+                std::cout << "  " << std::setw(15) << std::left << child->value << ": " << child->frameSize << " slots\n";
+            }
+        }
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Name Resolution Error: " << e.what() << "\n";
+        delete ast;
+        return 1;
+    }
+
+    std::vector<std::string> flowWarnings = analyzeFlow(ast);
+    std::cout << "\nFlow Analysis Results:\n";
+    std::cout << "=====================\n";
+    if (flowWarnings.empty()) {
+        std::cout << "No warnings.\n";
+    }
+    for (const std::string& warning : flowWarnings) {
+        std::cout << "  Warning: " << warning << "\n";
+    }
+
+    if (options.optimize) {
+        FoldStats foldStats = foldConstants(ast);
+        std::cout << "\nOptimization Results:\n";
+        std::cout << "====================\n";
+        std::cout << "  Constant expressions folded: " << foldStats.folded << "\n";
+        std::cout << "  Constants propagated: " << foldStats.propagated << "\n";
+        int deadNodes = eliminateDeadCode(ast);
+        std::cout << "  Dead nodes removed: " << deadNodes << "\n";
+        if (options.printOptimizedAst) {
+            ast->print();
+        }
+    }
+
+    // Built once for --print-ir and --run=ir, and optimized unless --no-opt
+    std::unique_ptr<IRProgram> ir;
+    if (options.printIR || options.runEngine == "ir") {
+        try {
+            ir = std::make_unique<IRProgram>(lowerToIR(ast));
+            if (options.optimize) {
+                IROptStats irStats = optimizeIR(*ir);
+                std::cout << "\nIR Optimization Results:\n";
+                std::cout << "=======================\n";
+                printIROptStats(irStats, std::cout);
+            }
+            if (options.printIR) {
+                std::cout << "\nIR:\n";
+                std::cout << "========================\n";
+                printIR(*ir, std::cout);
+            }
+        } catch (const std::runtime_error& e) {
+            std::cerr << "IR Error: " << e.what() << "\n";
+            delete ast;
+            return 1;
+        }
+    }
+
+    if (options.printBytecode && options.runEngine == "reg") {
+        try {
+            RegisterModule module = compileRegisterCode(ast);
+            std::cout << "\nRegister Code (" << module.code.size() << " words, " << module.registerCount
+                      << " registers, " << module.constants.size() << " constants):\n";
+            std::cout << "========================\n";
+            disassembleRegisters(module, std::cout);
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Bytecode Error: " << e.what() << "\n";
+            delete ast;
+            return 1;
+        }
+    } else if (options.printBytecode) {
+        try {
+            BytecodeModule module = compileStackCode(ast, options);
+            std::cout << "\nBytecode (" << module.code.size() << " words, " << module.constants.size()
+                      << " constants, max stack " << module.maxStack << "):\n";
+            std::cout << "========================\n";
+            disassemble(module, std::cout);
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Bytecode Error: " << e.what() << "\n";
+            delete ast;
+            return 1;
+        }
+    }
+
+    if (!options.emitModule.empty()) {
+        try {
+            writeModule(options.emitModule, compileStackCode(ast, options), dumpSymbols(ast), source);
+            std::cout << "\nModule written to " << options.emitModule << "\n";
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Module Error: " << e.what() << "\n";
+            delete ast;
+            return 1;
+        }
+    }
+
+    if (options.emitAsm || !options.objectFile.empty() || !options.executableFile.empty()) {
+        try {
+            X86Function function = compileX86(ast);
+            if (!options.objectFile.empty() || !options.executableFile.empty()) {
+                NativeImage image = buildNativeImage(function);
+                if (!options.objectFile.empty()) {
+                    writeElfObject(options.objectFile, image);
+                    std::cout << "\nObject written to " << options.objectFile << "\n";
+                }
+                if (!options.executableFile.empty()) {
+                    writeElfExecutable(options.executableFile, image);
+                    std::cout << "\nExecutable written to " << options.executableFile << "\n";
+                }
+            }
+            if (options.emitAsm && options.asmFile.empty()) {
+                std::cout << "\nAssembly (x86-64):\n";
+                std::cout << "========================\n";
+                printX86Assembly(function, std::cout);
+            } else if (options.emitAsm) {
+                std::ofstream file(options.asmFile);
+                if (!file.is_open()) {
+                    throw std::runtime_error("Could not write assembly: " + options.asmFile);
+                }
+                printX86Assembly(function, file);
+                std::cout << "\nAssembly written to " << options.asmFile << "\n";
+            }
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Codegen Error: " << e.what() << "\n";
+            delete ast;
+            return 1;
+        }
+    }
+
+    if (options.emitC || !options.cExecutableFile.empty()) {
+        try {
+            std::string cSource = generateC(ast);
+            if (!options.cExecutableFile.empty()) {
+                compileCExecutable(cSource, options.cExecutableFile, options.cOptimization);
+                std::cout << "\nExecutable written to " << options.cExecutableFile << " (C compiler, -O"
+                          << options.cOptimization << ")\n";
+            }
+            if (options.emitC && options.cFile.empty()) {
+                std::cout << "\nC Source:\n";
+                std::cout << "========================\n";
+                std::cout << cSource;
+            } else if (options.emitC) {
+                std::ofstream file(options.cFile);
+                if (!file.is_open()) {
+                    throw std::runtime_error("Could not write C source: " + options.cFile);
+                }
+                file << cSource;
+                std::cout << "\nC source written to " << options.cFile << "\n";
+            }
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Codegen Error: " << e.what() << "\n";
+            delete ast;
+            return 1;
+        }
+    }
+
     std::cout << "\nCompilation completed successfully.\n";
+
+    if (!options.runEngine.empty()) {
+        try {
+            OpcodeProfile profile;
+            RunStats stats;
+            auto start = std::chrono::steady_clock::now();
+            int32_t exitCode = runProgram(ast, ir.get(), options, options.profileOps ? &profile : nullptr, stats);
+            double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "\nExecution Results (" << options.runEngine << "):\n";
+            std::cout << "========================\n";
+            std::cout << "  Exit code: " << exitCode << "\n";
+            std::cout << "  Time: " << std::fixed << std::setprecision(3) << elapsed << " ms\n" << std::defaultfloat;
+            if (options.runEngine == "tiered") {
+                std::cout << "  Loops compiled: " << stats.tiers.loopsCompiled << " (" << stats.tiers.osrEntries
+                          << " entered mid-loop, " << stats.tiers.nativeEntries << " entered natively)\n";
+            }
+            if (options.runEngine == "ir") {
+                std::cout << "  IR instructions executed: " << stats.irInstructions << "\n";
+            }
+            if (options.profileOps) {
+                std::cout << "\nOpcode Profile";
+                if (!options.profileFile.empty()) {
+                    loadOpcodeProfile(options.profileFile, profile);
+                    saveOpcodeProfile(options.profileFile, profile);
+                    std::cout << " (totals in " << options.profileFile << ")";
+                }
+                std::cout << ":\n";
+                std::cout << "========================\n";
+                printOpcodeProfile(profile, std::cout);
+            }
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Runtime Error: " << e.what() << "\n";
+            delete ast;
+            return 1;
+        }
+    }
     delete ast;
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,383 @@
+#ifndef MODULE_H
+#define MODULE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "parser.h" // For ASTNode
+#include "visitor.h"
+#include "bytecode.h"
+#include "vm.h"
+
+// On-disk compiled module: a fixed header followed by the stack bytecode,
+// the constant pool and a text symbol dump. Integers are stored in the
+// writer's byte order, which byteOrder records. The code and constants are
+// 4-byte aligned, so a mapped file can be executed in place.
+//
+// Bump kModuleVersion whenever the layout or the opcode numbering changes.
+const uint32_t kModuleVersion = 2;
+const char kModuleMagic[8] = {'C', 'L', 'P', 'M', 'O', 'D', '\0', '\0'};
+const uint32_t kModuleByteOrder = 0x01020304;
+
+struct ModuleHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t opcodeCount;   // Opcode::Count of the writer
+    uint32_t codeWords;
+    uint32_t constantCount;
+    uint32_t globalCount;
+    uint32_t frameSize;
+    uint32_t maxStack;
+    uint32_t symbolBytes;
+    uint32_t reserved;
+    uint64_t sourceHash;    // Of the source text the module was compiled from
+    uint64_t checksum;      // Of the header (this field as 0) and everything after it
+};
+static_assert(sizeof(ModuleHeader) == 64, "ModuleHeader layout changed");
+
+uint64_t fnv1a(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ULL) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Checksum of a module file: the header with its checksum field cleared,
+// so forged counts are caught too, then the code, constants and symbols
+uint64_t moduleChecksum(const ModuleHeader& header, const void* code, size_t codeBytes, const void* constants,
+                        size_t constantBytes, const char* symbols) {
+    ModuleHeader cleared = header;
+    cleared.checksum = 0;
+    uint64_t checksum = fnv1a(&cleared, sizeof(cleared));
+    checksum = fnv1a(code, codeBytes, checksum);
+    checksum = fnv1a(constants, constantBytes, checksum);
+    return fnv1a(symbols, header.symbolBytes, checksum);
+}
+
+// Lists "global|local <type> <name> <slot>" lines for the globals and main's
+// locals, so a loaded module can still be related to its source
+class SymbolDumper : public ASTVisitor<SymbolDumper> {
+public:
+    std::string dump;
+
+    void visitDeclarationInt(ASTNode* node) { record(node, "int"); }
+    void visitDeclarationChar(ASTNode* node) { record(node, "char"); }
+
+private:
+    void record(ASTNode* node, const char* type) {
+        dump += std::string(node->isGlobal ? "global " : "local ") + type + " " + node->value + " " +
+                std::to_string(node->slot) + "\n";
+        visitChildren(node);
+    }
+};
+
+std::string dumpSymbols(ASTNode* program) {
+    SymbolDumper dumper;
+    ASTNode* mainFunction = findMainFunction(program);
+    for (ASTNode* child : program->children) {
+        if (child->kind != NodeKind::Function || child == mainFunction) {
+            dumper.visit(child);
+        }
+    }
+    return dumper.dump;
+}
+
+void writeModule(const std::string& path, const BytecodeModule& module, const std::string& symbols,
+                 const std::string& source) {
+    ModuleHeader header = {};
+    std::memcpy(header.magic, kModuleMagic, sizeof(header.magic));
+    header.version = kModuleVersion;
+    header.byteOrder = kModuleByteOrder;
+    header.opcodeCount = static_cast<uint32_t>(Opcode::Count);
+    header.codeWords = static_cast<uint32_t>(module.code.size());
+    header.constantCount = static_cast<uint32_t>(module.constants.size());
+    header.globalCount = module.globalCount;
+    header.frameSize = module.frameSize;
+    header.maxStack = module.maxStack;
+    header.symbolBytes = static_cast<uint32_t>(symbols.size());
+    header.sourceHash = fnv1a(source.data(), source.size());
+
+    size_t codeBytes = module.code.size() * sizeof(int32_t);
+    size_t constantBytes = module.constants.size() * sizeof(int32_t);
+    header.checksum =
+        moduleChecksum(header, module.code.data(), codeBytes, module.constants.data(), constantBytes, symbols.data());
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not write module: " + path);
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(module.code.data()), codeBytes);
+    file.write(reinterpret_cast<const char*>(module.constants.data()), constantBytes);
+    file.write(symbols.data(), symbols.size());
+    if (!file) {
+        throw std::runtime_error("Could not write module: " + path);
+    }
+}
+
+// Net operand stack change of an instruction, and how many values it needs
+// on the stack first
+void opcodeStackEffect(Opcode op, int& needs, int& delta) {
+    needs = 0;
+    delta = 0;
+    switch (op) {
+        case Opcode::Const:
+        case Opcode::LoadLocal:
+        case Opcode::LoadGlobal:
+        case Opcode::Trap:
+            delta = 1;
+            break;
+        case Opcode::Dup:
+            needs = 1;
+            delta = 1;
+            break;
+        case Opcode::StoreLocal:
+        case Opcode::StoreGlobal:
+        case Opcode::Pop:
+        case Opcode::JumpIfFalse:
+        case Opcode::JumpIfTrue:
+            needs = 1;
+            delta = -1;
+            break;
+        case Opcode::Add:
+        case Opcode::Sub:
+        case Opcode::Mul:
+        case Opcode::Div:
+        case Opcode::Eq:
+        case Opcode::Ne:
+        case Opcode::Lt:
+        case Opcode::Le:
+        case Opcode::Gt:
+        case Opcode::Ge:
+            needs = 2;
+            delta = -1;
+            break;
+        case Opcode::Neg:
+        case Opcode::Not:
+        case Opcode::Return:
+        case Opcode::StoreLocalLoadLocal:
+            needs = 1;
+            break;
+        case Opcode::LoadLocalConst:
+        case Opcode::LoadLocalLoadLocal:
+            delta = 2;
+            break;
+        default:
+            // Jump, AddLocalConstStore and BranchLocal*Const leave the stack alone
+            break;
+    }
+}
+
+// What verified bytecode actually touches: one past the highest global and
+// local slot it names, and the deepest its operand stack gets
+struct BytecodeUsage {
+    int32_t globals = 0;
+    int32_t locals = 0;
+    int32_t stack = 0;
+};
+
+// Checks that bytecode cannot read or write outside its arrays: opcodes and
+// operands are in range, jumps land on instruction starts, control never
+// runs off the end, and the stack depth at every instruction is the same on
+// all paths and stays within [0, maxStack].
+BytecodeUsage verifyBytecode(const int32_t* code, size_t codeWords, size_t constantCount, int32_t globalCount,
+                             int32_t frameSize, int32_t maxStack) {
+    auto fail = [](const std::string& why, size_t pc) {
+        throw std::runtime_error("Invalid bytecode at " + std::to_string(pc) + ": " + why);
+    };
+    auto inRange = [](int32_t value, size_t limit) { return value >= 0 && static_cast<size_t>(value) < limit; };
+    BytecodeUsage usage;
+    auto global = [&](int32_t slot, size_t pc) {
+        if (!inRange(slot, globalCount)) fail("bad global slot", pc);
+        usage.globals = std::max(usage.globals, slot + 1);
+    };
+    auto local = [&](int32_t slot, size_t pc) {
+        if (!inRange(slot, frameSize)) fail("bad local slot", pc);
+        usage.locals = std::max(usage.locals, slot + 1);
+    };
+
+    std::vector<char> isStart(codeWords, 0);
+    for (size_t pc = 0; pc < codeWords;) {
+        if (!inRange(code[pc], static_cast<size_t>(Opcode::Count))) fail("unknown opcode", pc);
+        Opcode op = static_cast<Opcode>(code[pc]);
+        isStart[pc] = 1;
+        pc += 1 + opcodeOperands(op);
+        if (pc > codeWords) fail("truncated instruction", pc);
+    }
+
+    std::vector<int32_t> depth(codeWords, -1);
+    std::vector<size_t> worklist;
+    if (codeWords == 0) fail("empty code", 0);
+    depth[0] = 0;
+    worklist.push_back(0);
+
+    auto flowTo = [&](size_t from, int32_t target, int32_t stackDepth) {
+        if (!inRange(target, codeWords) || !isStart[target]) fail("bad jump target", from);
+        if (depth[target] < 0) {
+            depth[target] = stackDepth;
+            worklist.push_back(target);
+        } else if (depth[target] != stackDepth) {
+            fail("inconsistent stack depth", target);
+        }
+    };
+
+    while (!worklist.empty()) {
+        size_t pc = worklist.back();
+        worklist.pop_back();
+        Opcode op = static_cast<Opcode>(code[pc]);
+        const int32_t* operands = code + pc + 1;
+
+        switch (op) {
+            case Opcode::Const:
+                if (!inRange(operands[0], constantCount)) fail("bad constant", pc);
+                break;
+            case Opcode::LoadGlobal:
+            case Opcode::StoreGlobal:
+                global(operands[0], pc);
+                break;
+            case Opcode::LoadLocal:
+            case Opcode::StoreLocal:
+            case Opcode::LoadLocalConst:
+                local(operands[0], pc);
+                break;
+            case Opcode::AddLocalConstStore:
+                local(operands[0], pc);
+                local(operands[2], pc);
+                break;
+            case Opcode::StoreLocalLoadLocal:
+            case Opcode::LoadLocalLoadLocal:
+                local(operands[0], pc);
+                local(operands[1], pc);
+                break;
+            case Opcode::BranchLocalEqConst:
+            case Opcode::BranchLocalNeConst:
+            case Opcode::BranchLocalLtConst:
+            case Opcode::BranchLocalLeConst:
+            case Opcode::BranchLocalGtConst:
+            case Opcode::BranchLocalGeConst:
+                local(operands[0], pc);
+                break;
+            default:
+                break;
+        }
+
+        int needs, delta;
+        opcodeStackEffect(op, needs, delta);
+        if (depth[pc] < needs) fail("stack underflow", pc);
+        int32_t after = depth[pc] + delta;
+        if (after > maxStack) fail("stack overflow", pc);
+        usage.stack = std::max(usage.stack, after);
+
+        if (op == Opcode::Return || op == Opcode::Trap) continue;
+        int jump = opcodeJumpOperand(op);
+        if (jump >= 0) flowTo(pc, operands[jump], after);
+        if (op == Opcode::Jump) continue;
+
+        size_t next = pc + 1 + opcodeOperands(op);
+        if (next >= codeWords) fail("control runs off the end", pc);
+        flowTo(pc, static_cast<int32_t>(next), after);
+    }
+    return usage;
+}
+
+// A module file mapped read-only into memory and validated. The code and
+// constant pool are used directly from the mapping. The arrays run() needs
+// are sized from what the verified code uses, not from the header counts.
+class MappedModule {
+private:
+    void* base = MAP_FAILED;
+    size_t size = 0;
+    BytecodeUsage usage;
+
+public:
+    const ModuleHeader* header = nullptr;
+    const int32_t* code = nullptr;
+    const int32_t* constants = nullptr;
+    const char* symbols = nullptr;
+
+    explicit MappedModule(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open module: " + path);
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(ModuleHeader)) {
+            ::close(fd);
+            throw std::runtime_error("Not a compiled module: " + path);
+        }
+        size = static_cast<size_t>(info.st_size);
+        base = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            throw std::runtime_error("Could not map module: " + path);
+        }
+        try {
+            validate(path);
+        } catch (...) {
+            ::munmap(base, size);
+            throw;
+        }
+    }
+
+    ~MappedModule() {
+        if (base != MAP_FAILED) ::munmap(base, size);
+    }
+
+    MappedModule(const MappedModule&) = delete;
+    MappedModule& operator=(const MappedModule&) = delete;
+
+private:
+    void validate(const std::string& path) {
+        const char* bytes = static_cast<const char*>(base);
+        header = reinterpret_cast<const ModuleHeader*>(bytes);
+        if (std::memcmp(header->magic, kModuleMagic, sizeof(kModuleMagic)) != 0) {
+            throw std::runtime_error("Not a compiled module: " + path);
+        }
+        if (header->byteOrder != kModuleByteOrder) {
+            throw std::runtime_error("Module was written on a machine with a different byte order: " + path);
+        }
+        if (header->version != kModuleVersion || header->opcodeCount != static_cast<uint32_t>(Opcode::Count)) {
+            throw std::runtime_error("Module was written by an incompatible compiler version: " + path);
+        }
+
+        uint64_t codeBytes = uint64_t(header->codeWords) * sizeof(int32_t);
+        uint64_t constantBytes = uint64_t(header->constantCount) * sizeof(int32_t);
+        if (sizeof(ModuleHeader) + codeBytes + constantBytes + header->symbolBytes != size ||
+            header->globalCount > INT32_MAX || header->frameSize > INT32_MAX || header->maxStack > INT32_MAX) {
+            throw std::runtime_error("Module is truncated or corrupt: " + path);
+        }
+        code = reinterpret_cast<const int32_t*>(bytes + sizeof(ModuleHeader));
+        constants = code + header->codeWords;
+        symbols = reinterpret_cast<const char*>(constants + header->constantCount);
+
+        if (moduleChecksum(*header, code, codeBytes, constants, constantBytes, symbols) != header->checksum) {
+            throw std::runtime_error("Module checksum mismatch: " + path);
+        }
+
+        usage = verifyBytecode(code, header->codeWords, header->constantCount, header->globalCount, header->frameSize,
+                       header->maxStack);
+    }
+
+public:
+    std::string symbolDump() const { return std::string(symbols, header->symbolBytes); }
+
+    // Runs the module's code in place and returns main's exit code
+    int32_t run() const {
+        std::vector<int32_t> globals(usage.globals, 0);
+        std::vector<int32_t> frame(usage.locals, 0);
+        std::vector<int32_t> stack(usage.stack + 1, 0);
+        return executeBytecode(code, constants, globals.data(), frame.data(), stack.data());
+    }
+};
+
+#endif
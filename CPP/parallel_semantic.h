@@ -0,0 +1,159 @@
+#ifndef PARALLEL_SEMANTIC_H
+#define PARALLEL_SEMANTIC_H
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <stdexcept>
+#include <vector>
+#include <string>
+#include "parser.h" // For ASTNode
+#include "semantic.h"
+#include "semantic_cache.h"
+
+// Upper bound on analysis threads when the number of cores is unknown
+const unsigned kMaxSemanticJobs = 64;
+
+// The thread count actually used for `jobs`: 0 means one per core, and more
+// threads than cores are never started
+unsigned semanticJobLimit(unsigned jobs) {
+    unsigned cores = std::thread::hardware_concurrency();
+    unsigned limit = cores ? cores : kMaxSemanticJobs;
+    return jobs == 0 ? limit : std::min(jobs, limit);
+}
+
+// Runs task(0) .. task(count - 1) on up to `jobs` threads, the caller included.
+// Tasks must not throw.
+template <typename Task>
+void runParallel(size_t count, unsigned jobs, Task task) {
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            task(i);
+        }
+    };
+
+    size_t workers = std::min<size_t>(jobs, count);
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < workers; ++t) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+// Result of analyzing one FUNCTION body
+struct FunctionDiagnostic {
+    bool failed = false;
+    std::string message;
+};
+
+// Two-phase semantic analysis. Phase one walks the PROGRAM's top level on the
+// calling thread, checking global declarations and recording every global and
+// function signature in a GlobalTable. Phase two analyzes each FUNCTION body on
+// a worker thread with its own scope stack layered over that table, seeing only
+// what was defined before it, exactly as the sequential walk would. The error
+// reported is the first one in source order, so results do not depend on
+// scheduling. jobs == 0 uses one thread per hardware core, and larger counts
+// are capped at it (see semanticJobLimit).
+//
+// With a cache, a function whose subtree and relevant globals hash the same as
+// in an earlier run reuses that run's result instead of being re-analyzed.
+void parallelSemanticAnalysis(ASTNode* ast, std::unordered_map<std::string, std::string>& outSymbolTable,
+                              unsigned jobs, SemanticCache* cache = nullptr) {
+    jobs = semanticJobLimit(jobs);
+
+    // Phase one: globals and function signatures
+    SymbolTable symbolTable;
+    SemanticAnalyzer globalAnalyzer(symbolTable);
+    GlobalTable globals;
+    std::vector<size_t> functionPositions;
+    size_t globalErrorPosition = ast->children.size();
+    std::string globalError;
+
+    for (size_t i = 0; i < ast->children.size(); ++i) {
+        ASTNode* child = ast->children[i];
+        try {
+            if (child->kind == NodeKind::Function) {
+                std::string returnType = child->children[0]->value;
+                symbolTable.define(child->value, returnType);
+                globals.define(child->value, returnType, i);
+                functionPositions.push_back(i);
+            } else {
+                globalAnalyzer.visit(child);
+                if (child->kind == NodeKind::DeclarationInt) {
+                    globals.define(child->value, "int", i);
+                } else if (child->kind == NodeKind::DeclarationChar) {
+                    globals.define(child->value, "char", i);
+                }
+            }
+        } catch (const std::runtime_error& e) {
+            // Nothing after the first global error would be reached sequentially
+            globalErrorPosition = i;
+            globalError = e.what();
+            break;
+        }
+    }
+
+    // Phase two: function bodies
+    std::vector<FunctionDiagnostic> diagnostics(functionPositions.size());
+    std::vector<uint64_t> keys(functionPositions.size());
+    std::vector<char> fromCache(functionPositions.size(), 0);
+    runParallel(functionPositions.size(), jobs, [&](size_t index) {
+        size_t position = functionPositions[index];
+        if (position > globalErrorPosition) return;
+
+        if (cache) {
+            ASTNode* function = ast->children[position];
+            keys[index] = mixHash(structuralHash(function), globalDependencyHash(function, globals, position));
+            if (const SemanticCache::Entry* entry = cache->find(keys[index])) {
+                diagnostics[index].failed = entry->failed;
+                diagnostics[index].message = entry->message;
+                fromCache[index] = 1;
+                return;
+            }
+        }
+
+        try {
+            SymbolTable localTable(globals, position);
+            SemanticAnalyzer analyzer(localTable);
+            analyzer.visit(ast->children[position]);
+        } catch (const std::exception& e) {
+            diagnostics[index].failed = true;
+            diagnostics[index].message = e.what();
+        }
+    });
+
+    if (cache) {
+        cache->beginRun();
+        for (size_t index = 0; index < functionPositions.size(); ++index) {
+            if (functionPositions[index] > globalErrorPosition) break;
+            if (fromCache[index]) {
+                cache->touch(keys[index]);
+                cache->hits++;
+            } else {
+                cache->store(keys[index], diagnostics[index].failed, diagnostics[index].message);
+                cache->misses++;
+            }
+        }
+        cache->endRun();
+    }
+
+    // Deterministic merge: earliest failure in source order wins
+    for (size_t index = 0; index < functionPositions.size(); ++index) {
+        if (functionPositions[index] > globalErrorPosition) break;
+        if (diagnostics[index].failed) {
+            throw std::runtime_error(diagnostics[index].message);
+        }
+    }
+    if (globalErrorPosition < ast->children.size()) {
+        throw std::runtime_error(globalError);
+    }
+
+    symbolTable.getAllSymbols(outSymbolTable);
+}
+
+#endif
@@ -6,22 +6,152 @@
 #include <stdexcept>
 #include <iostream>
 #include <cstddef> // For size_t
+#include <unordered_map>
+#include <functional>
+#include <memory>
 #include "lexer.h"
+#include "arith.h"
 
 // Forward declaration
 class Token;
 
+// Node kinds, mirroring the type strings the parser produces. Passes dispatch on
+// kind (see visitor.h) instead of comparing type strings.
+enum class NodeKind {
+    Program,
+    Include,
+    Function,
+    ReturnType,
+    Block,
+    DeclarationInt,
+    DeclarationChar,
+    If,
+    While,
+    For,
+    Return,
+    Assignment,
+    BinOp,
+    ComparisonOp,
+    LogicalOp,
+    UnaryOp,
+    Number,
+    Char,
+    String,
+    Identifier,
+    Unknown
+};
+
+const int NODE_KIND_COUNT = static_cast<int>(NodeKind::Unknown) + 1;
+
+NodeKind nodeKindFromType(const std::string& type) {
+    static const std::unordered_map<std::string, NodeKind> kinds = {
+        {"PROGRAM", NodeKind::Program},
+        {"INCLUDE", NodeKind::Include},
+        {"FUNCTION", NodeKind::Function},
+        {"RETURN_TYPE", NodeKind::ReturnType},
+        {"BLOCK", NodeKind::Block},
+        {"DECLARATION_INT", NodeKind::DeclarationInt},
+        {"DECLARATION_CHAR_TYPE", NodeKind::DeclarationChar},
+        {"IF", NodeKind::If},
+        {"WHILE", NodeKind::While},
+        {"FOR", NodeKind::For},
+        {"RETURN", NodeKind::Return},
+        {"ASSIGNMENT", NodeKind::Assignment},
+        {"BINOP", NodeKind::BinOp},
+        {"COMPARISON_OP", NodeKind::ComparisonOp},
+        {"LOGICAL_OP", NodeKind::LogicalOp},
+        {"UNARY_OP", NodeKind::UnaryOp},
+        {"NUMBER", NodeKind::Number},
+        {"CHAR", NodeKind::Char},
+        {"STRING", NodeKind::String},
+        {"IDENTIFIER", NodeKind::Identifier}
+    };
+    auto found = kinds.find(type);
+    return found != kinds.end() ? found->second : NodeKind::Unknown;
+}
+
+class ASTNode;
+
+// Structural identity of an interned expression node. Children are already
+// interned, so comparing their addresses compares whole subtrees.
+struct ExprKey {
+    NodeKind kind;
+    std::string value;
+    int binding; // Declaration an IDENTIFIER refers to, -1 otherwise
+    std::vector<ASTNode*> children;
+
+    bool operator==(const ExprKey& other) const {
+        return kind == other.kind && binding == other.binding && value == other.value &&
+               children == other.children;
+    }
+};
+
+struct ExprKeyHash {
+    size_t operator()(const ExprKey& key) const {
+        size_t hash = std::hash<std::string>()(key.value);
+        auto mix = [&hash](size_t part) { hash ^= part + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2); };
+        mix(static_cast<size_t>(key.kind));
+        mix(static_cast<size_t>(key.binding));
+        for (ASTNode* child : key.children) {
+            mix(std::hash<ASTNode*>()(child));
+        }
+        return hash;
+    }
+};
+
+// Owns the side-effect-free expression nodes shared in hash-consing mode. The
+// pool is attached to the PROGRAM node and frees them when the AST goes away.
+class ExprPool {
+private:
+    std::unordered_map<ExprKey, ASTNode*, ExprKeyHash> nodes;
+
+public:
+    int created = 0;
+    int reused = 0;
+
+    ~ExprPool();
+
+    ASTNode* intern(const std::string& type, const std::string& value, int binding,
+                    const std::vector<ASTNode*>& children);
+};
+
 // ASTNode class
 class ASTNode {
 public:
     std::string type;
     std::string value;
+    NodeKind kind;
     std::vector<ASTNode*> children;
 
-    ASTNode(const std::string& t, const std::string& v = "") : type(t), value(v) {}
+    // Filled in by name resolution (see resolver.h)
+    int slot = -1;          // Frame or global index for declarations, IDENTIFIER and ASSIGNMENT
+    bool isGlobal = false;  // Whether slot indexes the global array rather than the frame
+    int frameSize = 0;      // FUNCTION: number of local slots, PROGRAM: number of globals
+
+    // Hash-consing: interned nodes may have several parents and are owned by
+    // the ExprPool on the PROGRAM node. Passes must not modify them in place.
+    bool interned = false;
+    std::unique_ptr<ExprPool> pool;
+
+    // Value of a NUMBER or CHAR literal, decoded once
+    int32_t literal = 0;
+
+    // Source lines spanned by FUNCTION, WHILE and FOR nodes; 0 if unknown
+    int line = 0;
+    int endLine = 0;
+
+    ASTNode(const std::string& t, const std::string& v = "") : type(t), value(v), kind(nodeKindFromType(t)) {
+        if (kind == NodeKind::Number) {
+            literal = parseIntLiteral(value);
+        } else if (kind == NodeKind::Char) {
+            literal = charLiteralValue(value);
+        }
+    }
     ~ASTNode() {
         for (auto& child : children) {
-            delete child;
+            if (child && !child->interned) {
+                delete child;
+            }
         }
     }
 
@@ -53,12 +183,92 @@ public:
     }
 };
 
+ExprPool::~ExprPool() {
+    // Children are pool nodes too, which may already be gone
+    for (auto& entry : nodes) {
+        entry.second->children.clear();
+        delete entry.second;
+    }
+}
+
+ASTNode* ExprPool::intern(const std::string& type, const std::string& value, int binding,
+                          const std::vector<ASTNode*>& children) {
+    ExprKey key{nodeKindFromType(type), value, binding, children};
+    auto found = nodes.find(key);
+    if (found != nodes.end()) {
+        reused++;
+        return found->second;
+    }
+    ASTNode* node = new ASTNode(type, value);
+    node->children = children;
+    node->interned = true;
+    nodes.emplace(std::move(key), node);
+    created++;
+    return node;
+}
+
+// Deletes a node removed from the tree unless it is shared
+void releaseNode(ASTNode* node) {
+    if (node && !node->interned) {
+        delete node;
+    }
+}
+
 // Parser class
 class Parser {
 private:
     std::vector<Token> tokens;
     size_t pos;
 
+    // Hash-consing state: the pool, and the declaration each visible name refers
+    // to, so that only uses of the same variable share an IDENTIFIER node
+    std::unique_ptr<ExprPool> pool;
+    std::vector<std::unordered_map<std::string, int>> bindings;
+    int nextBinding = 0;
+
+    void enterBindingScope() {
+        if (pool) bindings.emplace_back();
+    }
+
+    void exitBindingScope() {
+        if (pool) bindings.pop_back();
+    }
+
+    void declareBinding(const std::string& name) {
+        if (pool) bindings.back()[name] = nextBinding++;
+    }
+
+    int lookupBinding(const std::string& name) const {
+        for (auto it = bindings.rbegin(); it != bindings.rend(); ++it) {
+            auto found = it->find(name);
+            if (found != it->end()) {
+                return found->second;
+            }
+        }
+        return -1;
+    }
+
+    // Builds an expression node. In hash-consing mode a node whose children are
+    // all shared is looked up structurally, so identical subtrees become one node.
+    ASTNode* makeExpression(const std::string& type, const std::string& value,
+                            const std::vector<ASTNode*>& children = {}) {
+        if (pool) {
+            bool shareable = true;
+            for (ASTNode* child : children) {
+                shareable = shareable && child->interned;
+            }
+            if (shareable) {
+                int binding = type == "IDENTIFIER" ? lookupBinding(value) : -1;
+                return pool->intern(type, value, binding, children);
+            }
+        }
+        ASTNode* node = new ASTNode(type, value);
+        for (ASTNode* child : children) {
+            node->addChild(child);
+        }
+        return node;
+    }
+
     Token peek(size_t offset = 0) {
         if (pos + offset >= tokens.size()) {
             return Token("EOF", "");
@@ -92,15 +302,22 @@ private:
         return includeNode;
     }
 
+    // Line of the last consumed token, where a construct ends
+    int previousLine() const {
+        return pos > 0 && pos <= tokens.size() ? tokens[pos - 1].line : 0;
+    }
+
     // Parse function definition
     ASTNode* parseFunction() {
         // Return type
+        int line = tokens[pos].line;
         std::string returnType = tokens[pos].value;
         consume("INT"); // Currently only supporting int return type
         
         // Function name
         std::string functionName = tokens[pos].value;
         consume("IDENTIFIER");
+        declareBinding(functionName);
         
         // Parameters (currently just empty)
         consume("LPAREN");
@@ -112,6 +329,8 @@ private:
         ASTNode* functionNode = new ASTNode("FUNCTION", functionName);
         functionNode->addChild(new ASTNode("RETURN_TYPE", returnType));
         functionNode->addChild(body);
+        functionNode->line = line;
+        functionNode->endLine = previousLine();
         
         return functionNode;
     }
@@ -119,6 +338,7 @@ private:
     // Parse a block of statements
     ASTNode* parseBlock() {
         consume("LBRACE");
+        enterBindingScope();
         
         ASTNode* blockNode = new ASTNode("BLOCK");
         
@@ -127,6 +347,7 @@ private:
         }
         
         consume("RBRACE");
+        exitBindingScope();
         return blockNode;
     }
 
@@ -140,6 +361,7 @@ private:
             consume("IDENTIFIER");
             
             ASTNode* decl = new ASTNode("DECLARATION_" + varType, varName);
+            declareBinding(varName); // Visible in its own initializer
             
             if (match("EQUALS")) {
                 ASTNode* expr = parseExpression();
@@ -211,6 +433,7 @@ private:
 
     // Parse while loop
     ASTNode* parseWhileLoop() {
+        int line = tokens[pos].line;
         consume("WHILE");
         consume("LPAREN");
         ASTNode* condition = parseExpression();
@@ -221,14 +444,18 @@ private:
         ASTNode* whileNode = new ASTNode("WHILE");
         whileNode->addChild(condition);
         whileNode->addChild(body);
+        whileNode->line = line;
+        whileNode->endLine = previousLine();
         
         return whileNode;
     }
 
     // Parse for loop
     ASTNode* parseForLoop() {
+        int line = tokens[pos].line;
         consume("FOR");
         consume("LPAREN");
+        enterBindingScope();
         
         // Initialization
         ASTNode* init = nullptr;
@@ -249,12 +476,15 @@ private:
         
         // Body
         ASTNode* body = parseBlock();
+        exitBindingScope();
         
         ASTNode* forNode = new ASTNode("FOR");
         forNode->addChild(init);
         forNode->addChild(condition);
         forNode->addChild(update);
         forNode->addChild(body);
+        forNode->line = line;
+        forNode->endLine = previousLine();
         
         return forNode;
     }
@@ -289,11 +519,7 @@ private:
             
             ASTNode* right = parseLogicalAnd();
             
-            ASTNode* node = new ASTNode("LOGICAL_OP", op);
-            node->addChild(left);
-            node->addChild(right);
-            
-            left = node;
+            left = makeExpression("LOGICAL_OP", op, {left, right});
         }
         
         return left;
@@ -308,11 +534,7 @@ private:
             
             ASTNode* right = parseEquality();
             
-            ASTNode* node = new ASTNode("LOGICAL_OP", op);
-            node->addChild(left);
-            node->addChild(right);
-            
-            left = node;
+            left = makeExpression("LOGICAL_OP", op, {left, right});
         }
         
         return left;
@@ -328,11 +550,7 @@ private:
             
             ASTNode* right = parseComparison();
             
-            ASTNode* node = new ASTNode("COMPARISON_OP", op);
-            node->addChild(left);
-            node->addChild(right);
-            
-            left = node;
+            left = makeExpression("COMPARISON_OP", op, {left, right});
         }
         
         return left;
@@ -349,11 +567,7 @@ private:
             
             ASTNode* right = parseAdditive();
             
-            ASTNode* node = new ASTNode("COMPARISON_OP", op);
-            node->addChild(left);
-            node->addChild(right);
-            
-            left = node;
+            left = makeExpression("COMPARISON_OP", op, {left, right});
         }
         
         return left;
@@ -369,11 +583,7 @@ private:
             
             ASTNode* right = parseTerm();
             
-            ASTNode* node = new ASTNode("BINOP", op);
-            node->addChild(left);
-            node->addChild(right);
-            
-            left = node;
+            left = makeExpression("BINOP", op, {left, right});
         }
         
         return left;
@@ -389,11 +599,7 @@ private:
             
             ASTNode* right = parseFactor();
             
-            ASTNode* node = new ASTNode("BINOP", op);
-            node->addChild(left);
-            node->addChild(right);
-            
-            left = node;
+            left = makeExpression("BINOP", op, {left, right});
         }
         
         return left;
@@ -411,10 +617,7 @@ private:
             
             ASTNode* operand = parseFactor();
             
-            ASTNode* node = new ASTNode("UNARY_OP", op);
-            node->addChild(operand);
-            
-            return node;
+            return makeExpression("UNARY_OP", op, {operand});
         }
         
         // Handle parentheses
@@ -428,21 +631,23 @@ private:
         // Handle literals and identifiers
         Token token = tokens[pos++];
         
-        if (token.type == "NUMBER") {
-            return new ASTNode("NUMBER", token.value);
-        } else if (token.type == "CHAR") {
-            return new ASTNode("CHAR", token.value);
-        } else if (token.type == "STRING") {
-            return new ASTNode("STRING", token.value);
-        } else if (token.type == "IDENTIFIER") {
-            return new ASTNode("IDENTIFIER", token.value);
+        if (token.type == "NUMBER" || token.type == "CHAR" ||
+            token.type == "STRING" || token.type == "IDENTIFIER") {
+            return makeExpression(token.type, token.value);
         }
         
         throw std::runtime_error("Unexpected token in expression: " + token.value);
     }
 
 public:
-    Parser(const std::vector<Token>& t) : tokens(t), pos(0) {}
+    // With hashConsing, side-effect-free expression subtrees are deduplicated
+    // into a DAG as they are built (see ExprPool)
+    Parser(const std::vector<Token>& t, bool hashConsing = false) : tokens(t), pos(0) {
+        if (hashConsing) {
+            pool.reset(new ExprPool());
+            bindings.emplace_back(); // Global scope
+        }
+    }
 
     ASTNode* parse() {
         ASTNode* root = new ASTNode("PROGRAM");
@@ -466,6 +671,7 @@ public:
             }
         }
         
+        root->pool = std::move(pool);
         return root;
     }
 };
@@ -0,0 +1,140 @@
+#ifndef PERFMAP_H
+#define PERFMAP_H
+
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+#include "parser.h" // For ASTNode
+
+// Tells Linux perf about code the JIT installs, which has no symbols of its
+// own. The perf map (/tmp/perf-<pid>.map) gives each block a name, which is
+// all `perf report` needs. A jitdump file (jit-<pid>.dump) also carries the
+// code bytes so `perf inject --jit` can annotate them; record with
+// `perf record -k 1` since its timestamps use CLOCK_MONOTONIC.
+class PerfMap {
+private:
+    static constexpr uint32_t kJitdumpMagic = 0x4A695444; // "JiTD"
+    static constexpr uint32_t kJitdumpVersion = 1;
+    static constexpr uint32_t kElfMachineX86_64 = 62;
+    static constexpr uint32_t kJitCodeLoad = 0;
+    static constexpr uint32_t kJitCodeClose = 3;
+
+    std::string sourceName;
+    FILE* mapFile = nullptr;
+    FILE* dumpFile = nullptr;
+    void* dumpMarker = MAP_FAILED;
+    size_t markerSize = 0;
+    uint64_t codeIndex = 0;
+
+    static uint64_t timestamp() {
+        timespec now;
+        ::clock_gettime(CLOCK_MONOTONIC, &now);
+        return static_cast<uint64_t>(now.tv_sec) * 1000000000 + static_cast<uint64_t>(now.tv_nsec);
+    }
+
+    template<typename T>
+    void put(const T& value) {
+        std::fwrite(&value, sizeof(T), 1, dumpFile);
+    }
+
+    void openJitdump(const std::string& directory) {
+        std::string path = directory + "/jit-" + std::to_string(::getpid()) + ".dump";
+        int fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0666);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open jitdump file: " + path);
+        }
+        // perf finds the dump through an executable mapping of it
+        markerSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        dumpMarker = ::mmap(nullptr, markerSize, PROT_READ | PROT_EXEC, MAP_PRIVATE, fd, 0);
+        dumpFile = ::fdopen(fd, "wb");
+        if (dumpMarker == MAP_FAILED || !dumpFile) {
+            if (!dumpFile) ::close(fd);
+            throw std::runtime_error("Could not map jitdump file: " + path);
+        }
+        put(kJitdumpMagic);
+        put(kJitdumpVersion);
+        put(uint32_t{40}); // Header size
+        put(kElfMachineX86_64);
+        put(uint32_t{0});
+        put(static_cast<uint32_t>(::getpid()));
+        put(timestamp());
+        put(uint64_t{0}); // Flags
+        std::fflush(dumpFile);
+    }
+
+public:
+    // Writes the perf map when perfMap is set and a jitdump file into
+    // jitdumpDirectory when that is not empty
+    PerfMap(const std::string& sourceName, bool perfMap, const std::string& jitdumpDirectory)
+        : sourceName(sourceName) {
+        if (perfMap) {
+            std::string path = "/tmp/perf-" + std::to_string(::getpid()) + ".map";
+            mapFile = std::fopen(path.c_str(), "a");
+            if (!mapFile) {
+                throw std::runtime_error("Could not open perf map: " + path);
+            }
+        }
+        if (!jitdumpDirectory.empty()) openJitdump(jitdumpDirectory);
+    }
+
+    PerfMap(const PerfMap&) = delete;
+    PerfMap& operator=(const PerfMap&) = delete;
+
+    ~PerfMap() {
+        if (mapFile) std::fclose(mapFile);
+        if (dumpFile) {
+            put(kJitCodeClose);
+            put(uint32_t{16});
+            put(timestamp());
+            std::fclose(dumpFile);
+        }
+        if (dumpMarker != MAP_FAILED) ::munmap(dumpMarker, markerSize);
+    }
+
+    // "main [file.cpp:3-10]" for a FUNCTION node; "main:for [file.cpp:5-7]"
+    // for a loop inside it
+    std::string symbolName(const ASTNode* function, const ASTNode* loop = nullptr) const {
+        const ASTNode* range = loop ? loop : function;
+        std::string name = function->value;
+        if (loop) name += loop->kind == NodeKind::For ? ":for" : ":while";
+        name += " [" + sourceName;
+        if (range->line > 0) {
+            name += ":" + std::to_string(range->line);
+            if (range->endLine > range->line) name += "-" + std::to_string(range->endLine);
+        }
+        return name + "]";
+    }
+
+    // Records code that is now executable at address
+    void add(const std::string& name, const uint8_t* address, size_t size) {
+        if (mapFile) {
+            std::fprintf(mapFile, "%llx %zx %s\n",
+                         static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(address)), size, name.c_str());
+            std::fflush(mapFile);
+        }
+        if (dumpFile) {
+            uint64_t vma = reinterpret_cast<uintptr_t>(address);
+            put(kJitCodeLoad);
+            put(static_cast<uint32_t>(16 + 40 + name.size() + 1 + size));
+            put(timestamp());
+            put(static_cast<uint32_t>(::getpid()));
+            put(static_cast<uint32_t>(::syscall(SYS_gettid)));
+            put(vma);
+            put(vma); // Code address
+            put(static_cast<uint64_t>(size));
+            put(codeIndex++);
+            std::fwrite(name.c_str(), 1, name.size() + 1, dumpFile);
+            std::fwrite(address, 1, size, dumpFile);
+            std::fflush(dumpFile);
+        }
+    }
+};
+
+#endif
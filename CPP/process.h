@@ -0,0 +1,53 @@
+#ifndef PROCESS_H
+#define PROCESS_H
+
+#include <csignal>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// Signals a compiled executable kills itself with after printing a runtime
+// error. Every exit status can also be a return value of main; a signal
+// cannot, so the runner can tell a trap from a normal exit.
+const int kDivideByZeroSignal = SIGFPE;
+const int kStringValueSignal = SIGABRT;
+
+// Runs argv[0] (searched on PATH when it has no slash) and waits for it;
+// returns its exit status, or -1 if it could not run or was killed. The
+// signal that killed it goes to *signal; with quiet, its stderr is dropped.
+int runProcess(const std::vector<std::string>& argv, int* signal = nullptr, bool quiet = false) {
+    std::vector<char*> arguments;
+    for (const std::string& argument : argv) arguments.push_back(const_cast<char*>(argument.c_str()));
+    arguments.push_back(nullptr);
+    int status = -1;
+    pid_t child = fork();
+    if (child == 0) {
+        if (quiet) {
+            int null = open("/dev/null", O_WRONLY);
+            if (null >= 0) dup2(null, STDERR_FILENO);
+        }
+        execvp(arguments[0], arguments.data());
+        _exit(127);
+    }
+    if (child < 0 || waitpid(child, &status, 0) < 0) return -1;
+    if (signal) *signal = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+    if (!WIFEXITED(status)) return -1;
+    return WEXITSTATUS(status);
+}
+
+// Runs a compiled program and returns main's exit status. A program that
+// trapped reports its error again here, as the in-process engines do, so
+// its own message is dropped.
+int runCompiledProgram(const std::string& executable, const char* what) {
+    int signal = 0;
+    int status = runProcess({executable}, &signal, true);
+    if (signal == kDivideByZeroSignal) throw std::runtime_error("Division by zero");
+    if (signal == kStringValueSignal) throw std::runtime_error("String values are not supported at runtime");
+    if (status < 0) throw std::runtime_error(std::string(what) + " did not exit normally");
+    return status;
+}
+
+#endif
@@ -0,0 +1,460 @@
+#ifndef REGCODE_H
+#define REGCODE_H
+
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "parser.h" // For ASTNode
+#include "constfold.h" // For constantValue
+#include "interpreter.h" // For findMainFunction
+
+// Register bytecode opcodes with their number of inline operands. Arithmetic
+// is three-address (dst, a, b) over the register file; Branch* compare two
+// registers and jump to an absolute target when the comparison holds.
+#define REGISTER_OPCODES(X) \
+    X(Move, 2)              \
+    X(LoadGlobal, 2)        \
+    X(StoreGlobal, 2)       \
+    X(Add, 3)               \
+    X(Sub, 3)               \
+    X(Mul, 3)               \
+    X(Div, 3)               \
+    X(Neg, 2)               \
+    X(Not, 2)               \
+    X(Eq, 3)                \
+    X(Ne, 3)                \
+    X(Lt, 3)                \
+    X(Le, 3)                \
+    X(Gt, 3)                \
+    X(Ge, 3)                \
+    X(Jump, 1)              \
+    X(JumpIfFalse, 2)       \
+    X(JumpIfTrue, 2)        \
+    X(BranchEq, 3)          \
+    X(BranchNe, 3)          \
+    X(BranchLt, 3)          \
+    X(BranchLe, 3)          \
+    X(BranchGt, 3)          \
+    X(BranchGe, 3)          \
+    X(Return, 1)            \
+    X(Trap, 0)
+
+enum class RegOpcode : int32_t {
+#define REGISTER_ENUM(name, operands) name,
+    REGISTER_OPCODES(REGISTER_ENUM)
+#undef REGISTER_ENUM
+    Count
+};
+
+const char* regOpcodeName(RegOpcode op) {
+    static const char* const names[] = {
+#define REGISTER_NAME(name, operands) #name,
+        REGISTER_OPCODES(REGISTER_NAME)
+#undef REGISTER_NAME
+    };
+    return names[static_cast<int32_t>(op)];
+}
+
+int regOpcodeOperands(RegOpcode op) {
+    static const int operands[] = {
+#define REGISTER_OPERANDS(name, count) count,
+        REGISTER_OPCODES(REGISTER_OPERANDS)
+#undef REGISTER_OPERANDS
+    };
+    return operands[static_cast<int32_t>(op)];
+}
+
+// A compiled program for the register VM. The register file holds main's
+// locals at their slot indices, then temporaries, then one read-only register
+// per constant starting at constantBase.
+struct RegisterModule {
+    std::vector<int32_t> code;
+    std::vector<int32_t> constants;
+    int32_t globalCount = 0;
+    int32_t constantBase = 0;
+    int32_t registerCount = 0;
+};
+
+// Compiles a resolved PROGRAM to register bytecode. Locals are used in place,
+// so `y = y + i;` is a single Add, and comparisons in conditions become a
+// single compare-and-branch.
+class RegisterCompiler {
+private:
+    struct Label {
+        int32_t position = -1;
+        std::vector<size_t> patches;
+    };
+
+    RegisterModule module;
+    std::unordered_map<int32_t, int32_t> constantIndex;
+    std::vector<size_t> constantOperands; // Operands to rebase past the temporaries
+    int32_t localCount = 0;
+    int32_t nextTemp = 0;
+    int32_t maxTemp = 0;
+
+    int32_t newTemp() {
+        int32_t temp = nextTemp++;
+        if (nextTemp > maxTemp) maxTemp = nextTemp;
+        return temp;
+    }
+
+    bool isConstantRegister(int32_t reg) const { return reg < 0; }
+
+    // Constants are numbered -1, -2, ... until their base is known
+    int32_t constantRegister(int32_t value) {
+        auto found = constantIndex.find(value);
+        if (found == constantIndex.end()) {
+            found = constantIndex.emplace(value, static_cast<int32_t>(module.constants.size())).first;
+            module.constants.push_back(value);
+        }
+        return -1 - found->second;
+    }
+
+    void emit(RegOpcode op, std::initializer_list<int32_t> operands) {
+        module.code.push_back(static_cast<int32_t>(op));
+        for (int32_t operand : operands) {
+            module.code.push_back(operand);
+        }
+    }
+
+    // Emits an instruction whose operands are all registers
+    void emitRegisters(RegOpcode op, std::initializer_list<int32_t> registers) {
+        module.code.push_back(static_cast<int32_t>(op));
+        for (int32_t reg : registers) {
+            if (isConstantRegister(reg)) constantOperands.push_back(module.code.size());
+            module.code.push_back(reg);
+        }
+    }
+
+    void emitTarget(Label& label) {
+        if (label.position < 0) {
+            label.patches.push_back(module.code.size());
+        }
+        module.code.push_back(label.position);
+    }
+
+    void bind(Label& label) {
+        label.position = static_cast<int32_t>(module.code.size());
+        for (size_t patch : label.patches) {
+            module.code[patch] = label.position;
+        }
+        label.patches.clear();
+    }
+
+    static RegOpcode binaryOpcode(const std::string& op) {
+        if (op == "+") return RegOpcode::Add;
+        if (op == "-") return RegOpcode::Sub;
+        if (op == "*") return RegOpcode::Mul;
+        if (op == "/") return RegOpcode::Div;
+        if (op == "==") return RegOpcode::Eq;
+        if (op == "!=") return RegOpcode::Ne;
+        if (op == "<") return RegOpcode::Lt;
+        if (op == "<=") return RegOpcode::Le;
+        if (op == ">") return RegOpcode::Gt;
+        if (op == ">=") return RegOpcode::Ge;
+        throw std::runtime_error("Unknown operator: " + op);
+    }
+
+    // The compare-and-branch taken when `a op b` is (or is not) true
+    static RegOpcode branchOpcode(const std::string& op, bool whenTrue) {
+        if (op == "==") return whenTrue ? RegOpcode::BranchEq : RegOpcode::BranchNe;
+        if (op == "!=") return whenTrue ? RegOpcode::BranchNe : RegOpcode::BranchEq;
+        if (op == "<") return whenTrue ? RegOpcode::BranchLt : RegOpcode::BranchGe;
+        if (op == "<=") return whenTrue ? RegOpcode::BranchLe : RegOpcode::BranchGt;
+        if (op == ">") return whenTrue ? RegOpcode::BranchGt : RegOpcode::BranchLe;
+        return whenTrue ? RegOpcode::BranchGe : RegOpcode::BranchLt;
+    }
+
+    static bool containsAssignment(const ASTNode* node) {
+        if (node->kind == NodeKind::Assignment) return true;
+        for (const ASTNode* child : node->children) {
+            if (containsAssignment(child)) return true;
+        }
+        return false;
+    }
+
+    // Evaluates both operands left to right. A local read directly from its
+    // register is copied first if the right operand could overwrite it.
+    void compileOperands(ASTNode* node, int32_t& left, int32_t& right) {
+        left = compileExpression(node->children[0]);
+        if (!isConstantRegister(left) && left < localCount && containsAssignment(node->children[1])) {
+            int32_t copy = newTemp();
+            emitRegisters(RegOpcode::Move, {copy, left});
+            left = copy;
+        }
+        right = compileExpression(node->children[1]);
+    }
+
+    void compileBranch(ASTNode* node, bool jumpWhen, Label& target) {
+        int32_t value;
+        if (constantValue(node, value)) {
+            if ((value != 0) == jumpWhen) {
+                emit(RegOpcode::Jump, {});
+                emitTarget(target);
+            }
+            return;
+        }
+        if (node->kind == NodeKind::UnaryOp && node->value == "!") {
+            compileBranch(node->children[0], !jumpWhen, target);
+            return;
+        }
+        if (node->kind == NodeKind::LogicalOp) {
+            bool decidesOn = node->value != "&&";
+            if (jumpWhen == decidesOn) {
+                compileBranch(node->children[0], jumpWhen, target);
+                compileBranch(node->children[1], jumpWhen, target);
+            } else {
+                Label skip;
+                compileBranch(node->children[0], decidesOn, skip);
+                compileBranch(node->children[1], jumpWhen, target);
+                bind(skip);
+            }
+            return;
+        }
+        if (node->kind == NodeKind::ComparisonOp) {
+            int32_t left, right;
+            compileOperands(node, left, right);
+            emitRegisters(branchOpcode(node->value, jumpWhen), {left, right});
+            emitTarget(target);
+            return;
+        }
+        int32_t reg = compileExpression(node);
+        emitRegisters(jumpWhen ? RegOpcode::JumpIfTrue : RegOpcode::JumpIfFalse, {reg});
+        emitTarget(target);
+    }
+
+    // Returns the register holding the expression's value. The result goes
+    // into target when one is given and an instruction computes it; callers
+    // move it there otherwise.
+    int32_t compileExpression(ASTNode* node, int32_t target = -1) {
+        int32_t left, right;
+        switch (node->kind) {
+            case NodeKind::Number:
+            case NodeKind::Char:
+                return constantRegister(node->literal);
+
+            case NodeKind::Identifier:
+                if (node->isGlobal) {
+                    int32_t reg = target >= 0 ? target : newTemp();
+                    emit(RegOpcode::LoadGlobal, {reg, node->slot});
+                    return reg;
+                }
+                return node->slot;
+
+            case NodeKind::Assignment: {
+                if (node->isGlobal) {
+                    int32_t value = compileExpression(node->children[0], target);
+                    module.code.push_back(static_cast<int32_t>(RegOpcode::StoreGlobal));
+                    module.code.push_back(node->slot);
+                    if (isConstantRegister(value)) constantOperands.push_back(module.code.size());
+                    module.code.push_back(value);
+                    return value;
+                }
+                int32_t value = compileExpression(node->children[0], node->slot);
+                if (value != node->slot) {
+                    emitRegisters(RegOpcode::Move, {node->slot, value});
+                }
+                return node->slot;
+            }
+
+            case NodeKind::BinOp:
+            case NodeKind::ComparisonOp: {
+                compileOperands(node, left, right);
+                int32_t reg = target >= 0 ? target : newTemp();
+                emitRegisters(binaryOpcode(node->value), {reg, left, right});
+                return reg;
+            }
+
+            case NodeKind::UnaryOp: {
+                left = compileExpression(node->children[0]);
+                int32_t reg = target >= 0 ? target : newTemp();
+                emitRegisters(node->value == "-" ? RegOpcode::Neg : RegOpcode::Not, {reg, left});
+                return reg;
+            }
+
+            case NodeKind::LogicalOp: {
+                // Build the result in a temporary so a target read by the
+                // operands is not overwritten early
+                int32_t reg = newTemp();
+                Label isFalse, done;
+                compileBranch(node, false, isFalse);
+                emitRegisters(RegOpcode::Move, {reg, constantRegister(1)});
+                emit(RegOpcode::Jump, {});
+                emitTarget(done);
+                bind(isFalse);
+                emitRegisters(RegOpcode::Move, {reg, constantRegister(0)});
+                bind(done);
+                return reg;
+            }
+
+            default:
+                // STRING values only fail once they are actually evaluated
+                emit(RegOpcode::Trap, {});
+                return newTemp();
+        }
+    }
+
+    void compileStore(ASTNode* target, ASTNode* value) {
+        int32_t reg = value ? compileExpression(value, target->isGlobal ? -1 : target->slot) : constantRegister(0);
+        if (target->isGlobal) {
+            module.code.push_back(static_cast<int32_t>(RegOpcode::StoreGlobal));
+            module.code.push_back(target->slot);
+            if (isConstantRegister(reg)) constantOperands.push_back(module.code.size());
+            module.code.push_back(reg);
+        } else if (reg != target->slot) {
+            emitRegisters(RegOpcode::Move, {target->slot, reg});
+        }
+    }
+
+    void compileStatement(ASTNode* node) {
+        // Temporaries never live across statements
+        nextTemp = localCount;
+
+        switch (node->kind) {
+            case NodeKind::Block:
+                for (ASTNode* child : node->children) {
+                    compileStatement(child);
+                }
+                break;
+
+            case NodeKind::DeclarationInt:
+            case NodeKind::DeclarationChar:
+                // Uninitialized variables start out as zero on every entry
+                compileStore(node, node->children.empty() ? nullptr : node->children[0]);
+                break;
+
+            case NodeKind::If: {
+                Label elseBranch, done;
+                compileBranch(node->children[0], false, elseBranch);
+                compileStatement(node->children[1]);
+                if (node->children.size() > 2) {
+                    emit(RegOpcode::Jump, {});
+                    emitTarget(done);
+                    bind(elseBranch);
+                    compileStatement(node->children[2]);
+                } else {
+                    bind(elseBranch);
+                }
+                bind(done);
+                break;
+            }
+
+            case NodeKind::While: {
+                Label body, condition;
+                emit(RegOpcode::Jump, {});
+                emitTarget(condition);
+                bind(body);
+                compileStatement(node->children[1]);
+                bind(condition);
+                nextTemp = localCount;
+                compileBranch(node->children[0], true, body);
+                break;
+            }
+
+            case NodeKind::For: {
+                Label body, condition;
+                compileStatement(node->children[0]);
+                emit(RegOpcode::Jump, {});
+                emitTarget(condition);
+                bind(body);
+                compileStatement(node->children[3]);
+                nextTemp = localCount;
+                compileExpression(node->children[2]);
+                bind(condition);
+                nextTemp = localCount;
+                compileBranch(node->children[1], true, body);
+                break;
+            }
+
+            case NodeKind::Return: {
+                int32_t reg = node->children.empty() ? constantRegister(0) : compileExpression(node->children[0]);
+                emitRegisters(RegOpcode::Return, {reg});
+                break;
+            }
+
+            default:
+                compileExpression(node);
+                break;
+        }
+    }
+
+public:
+    RegisterModule compile(ASTNode* program) {
+        ASTNode* mainFunction = findMainFunction(program);
+        module.globalCount = program->frameSize;
+        localCount = mainFunction->frameSize;
+        maxTemp = localCount;
+        for (ASTNode* child : program->children) {
+            if (child->kind == NodeKind::DeclarationInt || child->kind == NodeKind::DeclarationChar) {
+                compileStatement(child);
+            }
+        }
+        if (mainFunction->children.size() > 1) {
+            compileStatement(mainFunction->children[1]);
+        }
+        // Falling off the end of main returns 0
+        emitRegisters(RegOpcode::Return, {constantRegister(0)});
+
+        module.constantBase = maxTemp;
+        module.registerCount = maxTemp + static_cast<int32_t>(module.constants.size());
+        for (size_t operand : constantOperands) {
+            module.code[operand] = module.constantBase - 1 - module.code[operand];
+        }
+        return module;
+    }
+};
+
+RegisterModule compileRegisterCode(ASTNode* program) {
+    RegisterCompiler compiler;
+    return compiler.compile(program);
+}
+
+// Prints one instruction per line; registers are rN, constants #value,
+// globals gN and jump targets @index
+void disassembleRegisters(const RegisterModule& module, std::ostream& out) {
+    auto reg = [&](int32_t index) {
+        if (index >= module.constantBase) return "#" + std::to_string(module.constants[index - module.constantBase]);
+        return "r" + std::to_string(index);
+    };
+    for (size_t pc = 0; pc < module.code.size();) {
+        RegOpcode op = static_cast<RegOpcode>(module.code[pc]);
+        const int32_t* operands = &module.code[pc + 1];
+        out << "  " << std::setw(5) << std::right << pc << ": " << regOpcodeName(op) << std::left;
+        switch (op) {
+            case RegOpcode::LoadGlobal:
+                out << " " << reg(operands[0]) << ", g" << operands[1];
+                break;
+            case RegOpcode::StoreGlobal:
+                out << " g" << operands[0] << ", " << reg(operands[1]);
+                break;
+            case RegOpcode::Jump:
+                out << " @" << operands[0];
+                break;
+            case RegOpcode::JumpIfFalse:
+            case RegOpcode::JumpIfTrue:
+                out << " " << reg(operands[0]) << ", @" << operands[1];
+                break;
+            case RegOpcode::BranchEq:
+            case RegOpcode::BranchNe:
+            case RegOpcode::BranchLt:
+            case RegOpcode::BranchLe:
+            case RegOpcode::BranchGt:
+            case RegOpcode::BranchGe:
+                out << " " << reg(operands[0]) << ", " << reg(operands[1]) << ", @" << operands[2];
+                break;
+            default:
+                for (int i = 0; i < regOpcodeOperands(op); ++i) {
+                    out << (i == 0 ? " " : ", ") << reg(operands[i]);
+                }
+                break;
+        }
+        out << "\n";
+        pc += 1 + regOpcodeOperands(op);
+    }
+}
+
+#endif
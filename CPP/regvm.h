@@ -0,0 +1,103 @@
+#ifndef REGVM_H
+#define REGVM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "regcode.h"
+#include "vm.h" // For BYTECODE_COMPUTED_GOTO
+#include "arith.h"
+
+// Runs register bytecode starting at code[0] until a Return and yields its
+// value. regs must hold the module's registerCount values with locals zeroed
+// and the constants loaded at constantBase.
+int32_t executeRegisterCode(const int32_t* code, int32_t* regs, int32_t* globals) {
+    const int32_t* pc = code;
+
+#ifdef BYTECODE_COMPUTED_GOTO
+    static void* const labels[] = {
+#define REGISTER_LABEL(name, operands) &&op_##name,
+        REGISTER_OPCODES(REGISTER_LABEL)
+#undef REGISTER_LABEL
+    };
+#define CASE(name) op_##name:
+#define NEXT() goto *labels[*pc]
+    NEXT();
+#else
+#define CASE(name) case RegOpcode::name:
+#define NEXT() goto dispatch
+dispatch:
+    switch (static_cast<RegOpcode>(*pc)) {
+#endif
+
+#define BINARY(name, expr)                 \
+    CASE(name) {                           \
+        int32_t a = regs[pc[2]];           \
+        int32_t b = regs[pc[3]];           \
+        regs[pc[1]] = (expr);              \
+        pc += 4;                           \
+        NEXT();                            \
+    }
+#define BRANCH(name, cond)                 \
+    CASE(name) {                           \
+        int32_t a = regs[pc[1]];           \
+        int32_t b = regs[pc[2]];           \
+        pc = (cond) ? code + pc[3] : pc + 4; \
+        NEXT();                            \
+    }
+
+    CASE(Move)        regs[pc[1]] = regs[pc[2]]; pc += 3; NEXT();
+    CASE(LoadGlobal)  regs[pc[1]] = globals[pc[2]]; pc += 3; NEXT();
+    CASE(StoreGlobal) globals[pc[1]] = regs[pc[2]]; pc += 3; NEXT();
+    BINARY(Add, wrapAdd(a, b))
+    BINARY(Sub, wrapSub(a, b))
+    BINARY(Mul, wrapMul(a, b))
+    CASE(Div) {
+        int32_t b = regs[pc[3]];
+        if (b == 0) throw std::runtime_error("Division by zero");
+        regs[pc[1]] = wrapDiv(regs[pc[2]], b);
+        pc += 4;
+        NEXT();
+    }
+    CASE(Neg)         regs[pc[1]] = wrapNeg(regs[pc[2]]); pc += 3; NEXT();
+    CASE(Not)         regs[pc[1]] = regs[pc[2]] == 0; pc += 3; NEXT();
+    BINARY(Eq, a == b)
+    BINARY(Ne, a != b)
+    BINARY(Lt, a < b)
+    BINARY(Le, a <= b)
+    BINARY(Gt, a > b)
+    BINARY(Ge, a >= b)
+    CASE(Jump)        pc = code + pc[1]; NEXT();
+    CASE(JumpIfFalse) pc = regs[pc[1]] == 0 ? code + pc[2] : pc + 3; NEXT();
+    CASE(JumpIfTrue)  pc = regs[pc[1]] != 0 ? code + pc[2] : pc + 3; NEXT();
+    BRANCH(BranchEq, a == b)
+    BRANCH(BranchNe, a != b)
+    BRANCH(BranchLt, a < b)
+    BRANCH(BranchLe, a <= b)
+    BRANCH(BranchGt, a > b)
+    BRANCH(BranchGe, a >= b)
+    CASE(Return)      return regs[pc[1]];
+    CASE(Trap)        throw std::runtime_error("String values are not supported at runtime");
+
+#ifndef BYTECODE_COMPUTED_GOTO
+    default:
+        break;
+    }
+    throw std::runtime_error("Invalid opcode");
+#endif
+#undef BINARY
+#undef BRANCH
+#undef CASE
+#undef NEXT
+}
+
+// Runs a compiled register module and returns main's exit code
+int32_t runRegisterCode(const RegisterModule& module) {
+    std::vector<int32_t> globals(module.globalCount, 0);
+    std::vector<int32_t> regs(module.registerCount, 0);
+    std::copy(module.constants.begin(), module.constants.end(), regs.begin() + module.constantBase);
+    return executeRegisterCode(module.code.data(), regs.data(), globals.data());
+}
+
+#endif
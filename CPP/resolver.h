@@ -0,0 +1,133 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include <unordered_map>
+#include <stdexcept>
+#include <vector>
+#include <string>
+#include "parser.h" // For ASTNode
+#include "visitor.h"
+
+// Where a resolved name lives at runtime
+struct Binding {
+    int slot;
+    bool isGlobal;
+    bool isFunction;
+};
+
+// Scope chain used only while resolving; later phases index slots directly
+class ResolverScopes {
+private:
+    std::vector<std::unordered_map<std::string, Binding>> scopes;
+
+public:
+    ResolverScopes() {
+        // Initialize with global scope
+        enterScope();
+    }
+
+    void enterScope() {
+        scopes.push_back(std::unordered_map<std::string, Binding>());
+    }
+
+    void exitScope() {
+        if (scopes.size() > 1) { // Always keep at least global scope
+            scopes.pop_back();
+        }
+    }
+
+    bool atGlobalScope() const {
+        return scopes.size() == 1;
+    }
+
+    void define(const std::string& name, const Binding& binding) {
+        scopes.back()[name] = binding;
+    }
+
+    const Binding& lookup(const std::string& name) const {
+        for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+            auto found = it->find(name);
+            if (found != it->end()) {
+                return found->second;
+            }
+        }
+        throw std::runtime_error("Undefined variable: " + name);
+    }
+};
+
+// Slot assignment, dispatched by node kind
+class NameResolver : public ASTVisitor<NameResolver> {
+private:
+    ResolverScopes scopes;
+    int localCount = 0;
+
+    void resolveReference(ASTNode* node) {
+        const Binding& binding = scopes.lookup(node->value);
+        if (binding.isFunction) {
+            throw std::runtime_error("Function " + node->value + " cannot be used as a variable");
+        }
+        node->slot = binding.slot;
+        node->isGlobal = binding.isGlobal;
+    }
+
+public:
+    int globalCount = 0;
+
+    void visitFunction(ASTNode* node) {
+        scopes.define(node->value, Binding{-1, true, true});
+        localCount = 0;
+        visitChildren(node);
+        node->frameSize = localCount;
+    }
+
+    void visitBlock(ASTNode* node) {
+        scopes.enterScope();
+        visitChildren(node);
+        scopes.exitScope();
+    }
+
+    void visitFor(ASTNode* node) {
+        // The init declaration is scoped to the loop
+        scopes.enterScope();
+        visitChildren(node);
+        scopes.exitScope();
+    }
+
+    void visitDeclarationInt(ASTNode* node) { resolveDeclaration(node); }
+    void visitDeclarationChar(ASTNode* node) { resolveDeclaration(node); }
+
+    void resolveDeclaration(ASTNode* node) {
+        if (scopes.atGlobalScope()) {
+            node->slot = globalCount++;
+            node->isGlobal = true;
+        } else {
+            node->slot = localCount++;
+            node->isGlobal = false;
+        }
+        // Defined before the initializer is resolved, matching semanticAnalysis
+        scopes.define(node->value, Binding{node->slot, node->isGlobal, false});
+        visitChildren(node);
+    }
+
+    void visitAssignment(ASTNode* node) {
+        // The right-hand side is resolved first, as it is evaluated first
+        visitChildren(node);
+        resolveReference(node);
+    }
+
+    void visitIdentifier(ASTNode* node) {
+        resolveReference(node);
+    }
+};
+
+// Assigns every declaration a slot and rewrites IDENTIFIER/ASSIGNMENT nodes to
+// carry it. Globals are numbered across the PROGRAM; locals get a flat index into
+// their function's frame, so no two declarations in one function share a slot.
+// Must run after semanticAnalysis, which has already rejected undefined names.
+void resolveNames(ASTNode* ast) {
+    NameResolver resolver;
+    resolver.visit(ast);
+    ast->frameSize = resolver.globalCount;
+}
+
+#endif
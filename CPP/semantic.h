@@ -6,10 +6,41 @@
 #include <vector>
 #include <string>
 #include "parser.h" // For ASTNode
+#include "visitor.h"
+
+// Read-only view of the global scope used when functions are analyzed
+// independently. Each name keeps every definition together with the position of
+// the top-level item that made it, so a function only sees what was defined
+// before it in the source.
+class GlobalTable {
+private:
+    std::unordered_map<std::string, std::vector<std::pair<size_t, std::string>>> definitions;
+
+public:
+    void define(const std::string& name, const std::string& type, size_t position) {
+        definitions[name].push_back({position, type});
+    }
+
+    // Type of the latest definition made at or before position, or nullptr
+    const std::string* find(const std::string& name, size_t position) const {
+        auto found = definitions.find(name);
+        if (found == definitions.end()) {
+            return nullptr;
+        }
+        const std::string* type = nullptr;
+        for (const auto& [definedAt, definedType] : found->second) {
+            if (definedAt > position) break;
+            type = &definedType;
+        }
+        return type;
+    }
+};
 
 class SymbolTable {
 private:
     std::vector<std::unordered_map<std::string, std::string>> scopes;
+    const GlobalTable* globals = nullptr; // Consulted after all own scopes
+    size_t globalsPosition = 0;
 
 public:
     SymbolTable() {
@@ -17,6 +48,12 @@ public:
         enterScope();
     }
 
+    // Local scope stack layered over a shared, read-only global table
+    SymbolTable(const GlobalTable& globalTable, size_t position)
+        : globals(&globalTable), globalsPosition(position) {
+        enterScope();
+    }
+
     void enterScope() {
         scopes.push_back(std::unordered_map<std::string, std::string>());
     }
@@ -39,7 +76,7 @@ public:
                 return true;
             }
         }
-        return false;
+        return globals && globals->find(name, globalsPosition);
     }
 
     std::string getType(const std::string& name) const {
@@ -50,6 +87,11 @@ public:
                 return found->second;
             }
         }
+        if (globals) {
+            if (const std::string* type = globals->find(name, globalsPosition)) {
+                return *type;
+            }
+        }
         throw std::runtime_error("Undefined variable: " + name);
     }
 
@@ -63,96 +105,94 @@ public:
     }
 };
 
-void analyzeNode(ASTNode* ast, SymbolTable& symbolTable);
-
-// Forward declarations for analyzers
-void analyzeBlock(ASTNode* node, SymbolTable& symbolTable);
-void analyzeFunction(ASTNode* node, SymbolTable& symbolTable);
-void analyzeIfStatement(ASTNode* node, SymbolTable& symbolTable);
-void analyzeWhileLoop(ASTNode* node, SymbolTable& symbolTable);
-void analyzeForLoop(ASTNode* node, SymbolTable& symbolTable);
-void analyzeExpression(ASTNode* node, SymbolTable& symbolTable);
-
-// Main semantic analysis function
-void semanticAnalysis(ASTNode* ast, std::unordered_map<std::string, std::string>& outSymbolTable) {
-    SymbolTable symbolTable;
-    analyzeNode(ast, symbolTable);
-    symbolTable.getAllSymbols(outSymbolTable);
-}
-
-// Recursive analysis function
-void analyzeNode(ASTNode* ast, SymbolTable& symbolTable) {
-    if (!ast) return;
-
-    if (ast->type == "PROGRAM") {
-        // Process all program children
-        for (ASTNode* child : ast->children) {
-            analyzeNode(child, symbolTable);
+// Semantic checks, dispatched by node kind
+class SemanticAnalyzer : public ASTVisitor<SemanticAnalyzer> {
+private:
+    SymbolTable& symbolTable;
+
+    void checkIntInitializer(ASTNode* node, ASTNode* expr) {
+        if (expr->type == "CHAR" || expr->type == "STRING") {
+            throw std::runtime_error("Type mismatch: Cannot assign " + expr->type + " to int variable " + node->value);
+        } else if (expr->type == "IDENTIFIER") {
+            std::string exprType = symbolTable.getType(expr->value);
+            if (exprType != "int") {
+                throw std::runtime_error("Type mismatch: " + expr->value + " is not an int");
+            }
         }
     }
-    else if (ast->type == "INCLUDE") {
+
+public:
+    SemanticAnalyzer(SymbolTable& table) : symbolTable(table) {}
+
+    void visitInclude(ASTNode*) {
         // Nothing to analyze for includes
     }
-    else if (ast->type == "FUNCTION") {
-        analyzeFunction(ast, symbolTable);
+
+    void visitFunction(ASTNode* node) {
+        // Define function in symbol table
+        symbolTable.define(node->value, node->children[0]->value); // Return type
+        
+        // Analyze function body (should be a block)
+        if (node->children.size() > 1) {
+            visit(node->children[1]);
+        }
     }
-    else if (ast->type == "BLOCK") {
-        analyzeBlock(ast, symbolTable);
+
+    void visitBlock(ASTNode* node) {
+        symbolTable.enterScope();
+        visitChildren(node);
+        symbolTable.exitScope();
     }
-    else if (ast->type == "IF") {
-        analyzeIfStatement(ast, symbolTable);
+
+    void visitIf(ASTNode* node) {
+        // Condition, then branch and optional else branch
+        visitChildren(node);
     }
-    else if (ast->type == "WHILE") {
-        analyzeWhileLoop(ast, symbolTable);
+
+    void visitWhile(ASTNode* node) {
+        // Condition and body
+        visitChildren(node);
     }
-    else if (ast->type == "FOR") {
-        analyzeForLoop(ast, symbolTable);
+
+    void visitFor(ASTNode* node) {
+        // Initialization, condition, update and body share the loop scope
+        symbolTable.enterScope();
+        visitChildren(node);
+        symbolTable.exitScope();
     }
-    else if (ast->type == "DECLARATION_INT") {
-        symbolTable.define(ast->value, "int");
-        if (!ast->children.empty()) { // Check if initialized
-            ASTNode* expr = ast->children[0];
-            analyzeExpression(expr, symbolTable);
-            
-            if (expr->type == "CHAR" || expr->type == "STRING") {
-                throw std::runtime_error("Type mismatch: Cannot assign " + expr->type + " to int variable " + ast->value);
-            } else if (expr->type == "IDENTIFIER") {
-                std::string exprType = symbolTable.getType(expr->value);
-                if (exprType != "int") {
-                    throw std::runtime_error("Type mismatch: " + expr->value + " is not an int");
-                }
-            }
+
+    void visitDeclarationInt(ASTNode* node) {
+        symbolTable.define(node->value, "int");
+        if (!node->children.empty()) { // Check if initialized
+            ASTNode* expr = node->children[0];
+            visit(expr);
+            checkIntInitializer(node, expr);
         }
     }
-    else if (ast->type == "DECLARATION_CHAR_TYPE") {
-        symbolTable.define(ast->value, "char");
-        if (!ast->children.empty()) { // Check if initialized
-            ASTNode* expr = ast->children[0];
-            analyzeExpression(expr, symbolTable);
+
+    void visitDeclarationChar(ASTNode* node) {
+        symbolTable.define(node->value, "char");
+        if (!node->children.empty()) { // Check if initialized
+            ASTNode* expr = node->children[0];
+            visit(expr);
             
             if (expr->type != "CHAR") {
-                throw std::runtime_error("Type mismatch: Cannot assign " + expr->type + " to char variable " + ast->value);
+                throw std::runtime_error("Type mismatch: Cannot assign " + expr->type + " to char variable " + node->value);
             }
         }
     }
-    else if (ast->type == "ASSIGNMENT") {
-        if (!symbolTable.isDefined(ast->value)) {
-            throw std::runtime_error("Undefined variable: " + ast->value);
+
+    void visitAssignment(ASTNode* node) {
+        if (!symbolTable.isDefined(node->value)) {
+            throw std::runtime_error("Undefined variable: " + node->value);
         }
         
-        std::string varType = symbolTable.getType(ast->value);
-        ASTNode* expr = ast->children[0];
-        analyzeExpression(expr, symbolTable);
+        std::string varType = symbolTable.getType(node->value);
+        ASTNode* expr = node->children[0];
+        visit(expr);
         
         if (varType == "int") {
-            if (expr->type == "CHAR" || expr->type == "STRING") {
-                throw std::runtime_error("Type mismatch: Cannot assign " + expr->type + " to int variable " + ast->value);
-            } else if (expr->type == "IDENTIFIER") {
-                std::string exprType = symbolTable.getType(expr->value);
-                if (exprType != "int") {
-                    throw std::runtime_error("Type mismatch: " + expr->value + " is not an int");
-                }
-            }
+            checkIntInitializer(node, expr);
         } else if (varType == "char") {
             if (expr->type == "IDENTIFIER") {
                 std::string exprType = symbolTable.getType(expr->value);
@@ -160,104 +200,34 @@ void analyzeNode(ASTNode* ast, SymbolTable& symbolTable) {
                     throw std::runtime_error("Type mismatch: " + expr->value + " is not a char");
                 }
             } else if (expr->type != "CHAR") {
-                throw std::runtime_error("Type mismatch: Cannot assign " + expr->type + " to char variable " + ast->value);
+                throw std::runtime_error("Type mismatch: Cannot assign " + expr->type + " to char variable " + node->value);
             }
         }
     }
-    else if (ast->type == "IDENTIFIER") {
-        if (!symbolTable.isDefined(ast->value)) {
-            throw std::runtime_error("Undefined variable: " + ast->value);
-        }
-    }
-    else if (ast->type == "RETURN") {
-        if (!ast->children.empty()) {
-            analyzeExpression(ast->children[0], symbolTable);
-            // We could add return type checking here
-        }
-    }
-    else {
-        // Process any unknown node types
-        for (ASTNode* child : ast->children) {
-            analyzeNode(child, symbolTable);
-        }
-    }
-}
 
-void analyzeBlock(ASTNode* node, SymbolTable& symbolTable) {
-    symbolTable.enterScope();
-    
-    for (ASTNode* child : node->children) {
-        analyzeNode(child, symbolTable);
-    }
-    
-    symbolTable.exitScope();
-}
-
-void analyzeFunction(ASTNode* node, SymbolTable& symbolTable) {
-    // Define function in symbol table
-    symbolTable.define(node->value, node->children[0]->value); // Return type
-    
-    // Analyze function body (should be a block)
-    if (node->children.size() > 1) {
-        analyzeNode(node->children[1], symbolTable);
+    void visitIdentifier(ASTNode* node) {
+        if (!symbolTable.isDefined(node->value)) {
+            throw std::runtime_error("Undefined variable: " + node->value);
+        }
     }
-}
 
-void analyzeIfStatement(ASTNode* node, SymbolTable& symbolTable) {
-    // Analyze condition
-    analyzeExpression(node->children[0], symbolTable);
-    
-    // Analyze then branch
-    analyzeNode(node->children[1], symbolTable);
-    
-    // Analyze optional else branch
-    if (node->children.size() > 2) {
-        analyzeNode(node->children[2], symbolTable);
+    void visitReturn(ASTNode* node) {
+        // We could add return type checking here
+        visitChildren(node);
     }
-}
-
-void analyzeWhileLoop(ASTNode* node, SymbolTable& symbolTable) {
-    // Analyze condition
-    analyzeExpression(node->children[0], symbolTable);
-    
-    // Analyze body
-    analyzeNode(node->children[1], symbolTable);
-}
+};
 
-void analyzeForLoop(ASTNode* node, SymbolTable& symbolTable) {
-    symbolTable.enterScope();
-    
-    // Analyze initialization
-    analyzeNode(node->children[0], symbolTable);
-    
-    // Analyze condition
-    analyzeExpression(node->children[1], symbolTable);
-    
-    // Analyze update
-    analyzeExpression(node->children[2], symbolTable);
-    
-    // Analyze body
-    analyzeNode(node->children[3], symbolTable);
-    
-    symbolTable.exitScope();
+// Recursive analysis function
+void analyzeNode(ASTNode* ast, SymbolTable& symbolTable) {
+    SemanticAnalyzer analyzer(symbolTable);
+    analyzer.visit(ast);
 }
 
-void analyzeExpression(ASTNode* node, SymbolTable& symbolTable) {
-    if (!node) return;
-    
-    if (node->type == "IDENTIFIER") {
-        if (!symbolTable.isDefined(node->value)) {
-            throw std::runtime_error("Undefined variable: " + node->value);
-        }
-    }
-    else if (node->type == "BINOP" || node->type == "LOGICAL_OP" || 
-             node->type == "COMPARISON_OP" || node->type == "UNARY_OP") {
-        for (ASTNode* child : node->children) {
-            analyzeExpression(child, symbolTable);
-        }
-    }
-    
-    // For other expression types (literals), no analysis needed
+// Main semantic analysis function
+void semanticAnalysis(ASTNode* ast, std::unordered_map<std::string, std::string>& outSymbolTable) {
+    SymbolTable symbolTable;
+    analyzeNode(ast, symbolTable);
+    symbolTable.getAllSymbols(outSymbolTable);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,104 @@
+#ifndef SEMANTIC_CACHE_H
+#define SEMANTIC_CACHE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "parser.h" // For ASTNode
+#include "semantic.h" // For GlobalTable
+
+uint64_t mixHash(uint64_t hash, uint64_t part) {
+    return hash ^ (part + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2));
+}
+
+// Hash of a subtree's shape: node types, values and child order
+uint64_t structuralHash(const ASTNode* node) {
+    uint64_t hash = std::hash<std::string>()(node->type);
+    hash = mixHash(hash, std::hash<std::string>()(node->value));
+    hash = mixHash(hash, node->children.size());
+    for (const ASTNode* child : node->children) {
+        hash = mixHash(hash, child ? structuralHash(child) : 0);
+    }
+    return hash;
+}
+
+// Collects every name a subtree reads or assigns
+void collectReferencedNames(const ASTNode* node, std::vector<std::string>& names) {
+    if (node->kind == NodeKind::Identifier || node->kind == NodeKind::Assignment) {
+        names.push_back(node->value);
+    }
+    for (const ASTNode* child : node->children) {
+        if (child) collectReferencedNames(child, names);
+    }
+}
+
+// Hash of what the global scope says, at the function's position, about each
+// name the function references. Locals that happen to share a global's name
+// are included too, which can only cause extra re-analysis.
+uint64_t globalDependencyHash(const ASTNode* function, const GlobalTable& globals, size_t position) {
+    std::vector<std::string> names;
+    collectReferencedNames(function, names);
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+
+    uint64_t hash = 0;
+    for (const std::string& name : names) {
+        const std::string* type = globals.find(name, position);
+        hash = mixHash(hash, std::hash<std::string>()(name));
+        hash = mixHash(hash, type ? std::hash<std::string>()(*type) : 0);
+    }
+    return hash;
+}
+
+// Per-FUNCTION semantic results kept across runs of the front end, keyed by
+// the function's structural hash combined with its global dependency hash.
+// Entries not used by the latest run are dropped, so the cache stays the size
+// of the current program.
+class SemanticCache {
+public:
+    struct Entry {
+        bool failed = false;
+        std::string message;
+        unsigned generation = 0;
+    };
+
+private:
+    std::unordered_map<uint64_t, Entry> entries;
+    unsigned generation = 0;
+
+public:
+    int hits = 0;
+    int misses = 0;
+
+    void beginRun() {
+        generation++;
+        hits = 0;
+        misses = 0;
+    }
+
+    // Safe to call concurrently as long as no store() runs at the same time
+    const Entry* find(uint64_t key) const {
+        auto found = entries.find(key);
+        return found != entries.end() ? &found->second : nullptr;
+    }
+
+    void touch(uint64_t key) {
+        entries[key].generation = generation;
+    }
+
+    void store(uint64_t key, bool failed, const std::string& message) {
+        entries[key] = Entry{failed, message, generation};
+    }
+
+    void endRun() {
+        for (auto it = entries.begin(); it != entries.end();) {
+            it = it->second.generation == generation ? std::next(it) : entries.erase(it);
+        }
+    }
+
+    size_t size() const { return entries.size(); }
+};
+
+#endif
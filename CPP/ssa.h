@@ -0,0 +1,504 @@
+#ifndef SSA_H
+#define SSA_H
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "ir.h"
+
+// Dominator tree of a function's CFG, by Cooper, Harvey and Kennedy's
+// iterative algorithm over reverse postorder. Unreachable blocks have no
+// immediate dominator (-1); the entry is its own.
+struct DominatorTree {
+    std::vector<int32_t> idom;
+    std::vector<int32_t> order;       // Reachable blocks in reverse postorder
+    std::vector<int32_t> orderIndex;  // By block; -1 if unreachable
+    std::vector<uint32_t> childBegin; // Tree children [childBegin[b], childBegin[b + 1])
+    std::vector<int32_t> children;    // of this array, in block order
+    std::vector<uint32_t> enter;      // Preorder and postorder numbers of a
+    std::vector<uint32_t> leave;      // depth-first walk of the tree
+
+    bool reachable(int32_t block) const { return orderIndex[block] >= 0; }
+
+    bool dominates(int32_t a, int32_t b) const {
+        return reachable(a) && reachable(b) && enter[a] <= enter[b] && leave[b] <= leave[a];
+    }
+
+    // Calls visit(block, true) on entering each subtree and visit(block,
+    // false) on leaving it, without recursion so deep trees are fine
+    template <typename Visit>
+    void walk(Visit visit) const {
+        std::vector<std::pair<int32_t, uint32_t>> stack = {{0, childBegin[0]}};
+        visit(0, true);
+        while (!stack.empty()) {
+            auto& [block, next] = stack.back();
+            if (next < childBegin[block + 1]) {
+                int32_t child = children[next++];
+                visit(child, true);
+                stack.push_back({child, childBegin[child]});
+            } else {
+                visit(block, false);
+                stack.pop_back();
+            }
+        }
+    }
+};
+
+DominatorTree buildDominators(const IRFunction& function) {
+    size_t count = function.blocks.size();
+    DominatorTree tree;
+    tree.idom.assign(count, -1);
+    tree.orderIndex.assign(count, -1);
+
+    // Postorder by an explicit depth-first search
+    std::vector<uint8_t> seen(count, 0);
+    std::vector<std::pair<int32_t, int>> stack = {{0, 0}};
+    seen[0] = 1;
+    while (!stack.empty()) {
+        auto& [block, next] = stack.back();
+        if (next < 2) {
+            int32_t succ = function.blocks[block].succ[next++];
+            if (succ >= 0 && !seen[succ]) {
+                seen[succ] = 1;
+                stack.push_back({succ, 0});
+            }
+        } else {
+            tree.order.push_back(block);
+            stack.pop_back();
+        }
+    }
+    std::reverse(tree.order.begin(), tree.order.end());
+    for (size_t i = 0; i < tree.order.size(); ++i) tree.orderIndex[tree.order[i]] = static_cast<int32_t>(i);
+
+    tree.idom[0] = 0;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t i = 1; i < tree.order.size(); ++i) {
+            int32_t block = tree.order[i];
+            int32_t newIdom = -1;
+            const int32_t* preds = function.predsOf(block);
+            for (uint32_t p = 0; p < function.blocks[block].predCount; ++p) {
+                int32_t pred = preds[p];
+                if (tree.idom[pred] < 0) continue;
+                if (newIdom < 0) {
+                    newIdom = pred;
+                    continue;
+                }
+                int32_t a = pred, b = newIdom;
+                while (a != b) {
+                    while (tree.orderIndex[a] > tree.orderIndex[b]) a = tree.idom[a];
+                    while (tree.orderIndex[b] > tree.orderIndex[a]) b = tree.idom[b];
+                }
+                newIdom = a;
+            }
+            if (tree.idom[block] != newIdom) {
+                tree.idom[block] = newIdom;
+                changed = true;
+            }
+        }
+    }
+
+    tree.childBegin.assign(count + 1, 0);
+    for (size_t b = 1; b < count; ++b) {
+        if (tree.idom[b] >= 0) tree.childBegin[tree.idom[b] + 1]++;
+    }
+    for (size_t b = 0; b < count; ++b) tree.childBegin[b + 1] += tree.childBegin[b];
+    tree.children.assign(tree.childBegin[count], -1);
+    std::vector<uint32_t> fill(tree.childBegin.begin(), tree.childBegin.end() - 1);
+    for (size_t b = 1; b < count; ++b) {
+        if (tree.idom[b] >= 0) tree.children[fill[tree.idom[b]]++] = static_cast<int32_t>(b);
+    }
+
+    tree.enter.assign(count, 0);
+    tree.leave.assign(count, 0);
+    uint32_t clock = 0;
+    tree.walk([&](int32_t block, bool entering) { (entering ? tree.enter : tree.leave)[block] = clock++; });
+    return tree;
+}
+
+// Dominance frontier of every block: where a definition in the block stops
+// dominating and a phi may be needed
+std::vector<std::vector<int32_t>> dominanceFrontiers(const IRFunction& function, const DominatorTree& tree) {
+    std::vector<std::vector<int32_t>> frontiers(function.blocks.size());
+    for (size_t b = 0; b < function.blocks.size(); ++b) {
+        const IRBlock& block = function.blocks[b];
+        if (block.predCount < 2 || !tree.reachable(static_cast<int32_t>(b))) continue;
+        const int32_t* preds = function.predsOf(static_cast<int32_t>(b));
+        for (uint32_t p = 0; p < block.predCount; ++p) {
+            for (int32_t runner = preds[p]; tree.reachable(runner) && runner != tree.idom[b]; runner = tree.idom[runner]) {
+                std::vector<int32_t>& frontier = frontiers[runner];
+                if (frontier.empty() || frontier.back() != static_cast<int32_t>(b)) frontier.push_back(static_cast<int32_t>(b));
+            }
+        }
+    }
+    return frontiers;
+}
+
+struct SSAStats {
+    int phis = 0;               // Phi nodes inserted
+    int constants = 0;          // Values SCCP proved constant
+    int branchesFolded = 0;     // Branches SCCP proved go one way
+    int blocksRemoved = 0;      // Blocks found unreachable
+    int deadInstructions = 0;   // Instructions whose results were never used
+};
+
+// Rewrites a lowered function into SSA form. Locals, and temporaries that
+// are assigned in more than one place, are variables: each definition gets
+// a fresh value, and phis merge them where control flow joins. Phis are
+// only placed for variables that are live into some block (semi-pruned
+// SSA). A variable read before any definition reads a shared zero, as a
+// frame slot would.
+void convertToSSA(IRFunction& function, SSAStats& stats) {
+    int32_t valueCount = function.valueCount();
+    size_t blockCount = function.blocks.size();
+    std::vector<uint8_t> isVariable(valueCount, 0);
+    std::vector<int32_t> definitions(valueCount, 0);
+    for (const IRInstr& instr : function.code) {
+        if (instr.dest >= 0) definitions[instr.dest]++;
+    }
+    for (int32_t v = 0; v < valueCount; ++v) {
+        isVariable[v] = v < function.frameSize || definitions[v] > 1;
+    }
+
+    // Variables read in a block before it defines them, and each
+    // variable's defining blocks (the entry defines every variable as zero)
+    std::vector<uint8_t> liveSomewhere(valueCount, 0);
+    std::vector<std::vector<int32_t>> defBlocks(valueCount);
+    std::vector<int32_t> definedIn(valueCount, -1);
+    for (size_t b = 0; b < blockCount; ++b) {
+        const IRBlock& block = function.blocks[b];
+        for (uint32_t i = block.begin; i < block.end; ++i) {
+            const IRInstr& instr = function.code[i];
+            forEachIRUse(instr, [&](int32_t v) {
+                if (isVariable[v] && definedIn[v] != static_cast<int32_t>(b)) liveSomewhere[v] = 1;
+            });
+            if (instr.dest >= 0 && isVariable[instr.dest] && definedIn[instr.dest] != static_cast<int32_t>(b)) {
+                definedIn[instr.dest] = static_cast<int32_t>(b);
+                defBlocks[instr.dest].push_back(static_cast<int32_t>(b));
+            }
+        }
+    }
+
+    DominatorTree tree = buildDominators(function);
+    std::vector<std::vector<int32_t>> frontiers = dominanceFrontiers(function, tree);
+
+    // Phi placement on the iterated dominance frontier
+    std::vector<std::vector<int32_t>> phiVariables(blockCount);
+    std::vector<int32_t> hasPhi(blockCount, -1), queued(blockCount, -1);
+    std::vector<int32_t> worklist;
+    for (int32_t v = 0; v < valueCount; ++v) {
+        if (!isVariable[v] || !liveSomewhere[v]) continue;
+        worklist = defBlocks[v];
+        worklist.push_back(0);
+        for (int32_t b : worklist) queued[b] = v;
+        while (!worklist.empty()) {
+            int32_t b = worklist.back();
+            worklist.pop_back();
+            for (int32_t frontier : frontiers[b]) {
+                if (hasPhi[frontier] == v) continue;
+                hasPhi[frontier] = v;
+                phiVariables[frontier].push_back(v);
+                stats.phis++;
+                if (queued[frontier] != v) {
+                    queued[frontier] = v;
+                    worklist.push_back(frontier);
+                }
+            }
+        }
+    }
+
+    IRDraft draft = unpackIR(function);
+    std::vector<int32_t> phiVariable; // By phi list
+    for (size_t b = 0; b < blockCount; ++b) {
+        std::vector<IRInstr> phis;
+        for (int32_t v : phiVariables[b]) {
+            phis.push_back({IROp::Phi, v, static_cast<int32_t>(draft.phis.size()), 0});
+            draft.phis.emplace_back();
+            phiVariable.push_back(v);
+        }
+        std::vector<IRInstr>& code = draft.blocks[b].code;
+        code.insert(code.begin(), phis.begin(), phis.end());
+    }
+
+    // Renaming, down the dominator tree; current[v] is the reaching
+    // definition, and undo remembers what each block overwrote
+    std::vector<int32_t> current(valueCount, -1);
+    std::vector<std::pair<int32_t, int32_t>> undo;
+    std::vector<size_t> undoMarks;
+    int32_t zero = -1;
+    auto reaching = [&](int32_t v) {
+        if (current[v] >= 0) return current[v];
+        if (zero < 0) zero = function.newValue();
+        return zero;
+    };
+    auto define = [&](int32_t v) {
+        int32_t version = function.newValue(v < function.frameSize ? v : -1);
+        undo.push_back({v, current[v]});
+        current[v] = version;
+        return version;
+    };
+    tree.walk([&](int32_t b, bool entering) {
+        if (!entering) {
+            for (size_t mark = undoMarks.back(); undo.size() > mark; undo.pop_back()) {
+                current[undo.back().first] = undo.back().second;
+            }
+            undoMarks.pop_back();
+            return;
+        }
+        undoMarks.push_back(undo.size());
+        IRBlockDraft& block = draft.blocks[b];
+        for (IRInstr& instr : block.code) {
+            if (instr.op != IROp::Phi) {
+                forEachIRUse(instr, [&](int32_t& v) {
+                    if (isVariable[v]) v = reaching(v);
+                });
+            }
+            if (instr.dest >= 0 && isVariable[instr.dest]) instr.dest = define(instr.dest);
+        }
+        for (int i = 0; i < 2; ++i) {
+            int32_t succ = block.succ[i];
+            if (succ < 0 || (i == 1 && succ == block.succ[0])) continue;
+            for (const IRInstr& instr : draft.blocks[succ].code) {
+                if (instr.op != IROp::Phi) break;
+                draft.phis[instr.a].push_back({b, reaching(phiVariable[instr.a])});
+            }
+        }
+    });
+    if (zero >= 0) {
+        std::vector<IRInstr>& entry = draft.blocks[0].code;
+        entry.insert(entry.begin(), IRInstr{IROp::Const, zero, 0, -1});
+    }
+    packIR(function, draft);
+}
+
+// Sparse conditional constant propagation (Wegman and Zadeck) over SSA.
+// Values start out unknown and blocks unreachable; only edges that can
+// run are followed, so a branch on a value proved constant keeps the other
+// side, and any phi operands from it, out of the analysis. Constant values
+// become Const instructions and decided branches become jumps; the blocks
+// that can no longer run are dropped.
+class ConstantPropagation {
+private:
+    enum class Lattice : uint8_t { Unknown, Constant, Varying };
+
+    IRFunction& function;
+    std::vector<Lattice> state;
+    std::vector<int32_t> constant;
+    std::vector<int32_t> blockOf;    // By instruction
+    std::vector<uint32_t> useBegin;  // Instructions using each value, including
+    std::vector<uint32_t> uses;      // phis through their operands
+    std::vector<uint8_t> blockLive;
+    std::vector<uint8_t> edgeLive;   // By block and successor slot
+    std::vector<std::pair<int32_t, int>> edgeWork;
+    std::vector<uint32_t> valueWork;
+
+    void buildUses() {
+        size_t count = function.code.size();
+        useBegin.assign(function.valueCount() + 1, 0);
+        auto forEachOperand = [&](uint32_t i, auto visit) {
+            const IRInstr& instr = function.code[i];
+            if (instr.op == IROp::Phi) {
+                for (int32_t k = 0; k < instr.b; ++k) visit(function.phiArgs[instr.a + k].value);
+            } else {
+                forEachIRUse(instr, visit);
+            }
+        };
+        for (uint32_t i = 0; i < count; ++i) forEachOperand(i, [&](int32_t v) { useBegin[v + 1]++; });
+        for (size_t v = 1; v < useBegin.size(); ++v) useBegin[v] += useBegin[v - 1];
+        uses.assign(useBegin.back(), 0);
+        std::vector<uint32_t> fill(useBegin.begin(), useBegin.end() - 1);
+        for (uint32_t i = 0; i < count; ++i) forEachOperand(i, [&](int32_t v) { uses[fill[v]++] = i; });
+    }
+
+    bool edgeRuns(int32_t from, int32_t to) const {
+        const IRBlock& block = function.blocks[from];
+        return (block.succ[0] == to && edgeLive[2 * from]) || (block.succ[1] == to && edgeLive[2 * from + 1]);
+    }
+
+    void lower(int32_t value, Lattice newState, int32_t newConstant = 0) {
+        if (state[value] == Lattice::Constant && newState == Lattice::Constant && constant[value] != newConstant) {
+            newState = Lattice::Varying;
+        }
+        if (state[value] == newState || state[value] == Lattice::Varying) return;
+        state[value] = newState;
+        constant[value] = newConstant;
+        for (uint32_t u = useBegin[value]; u < useBegin[value + 1]; ++u) valueWork.push_back(uses[u]);
+    }
+
+    void markEdge(int32_t from, int slot) {
+        int32_t to = function.blocks[from].succ[slot];
+        if (to < 0 || edgeLive[2 * from + slot]) return;
+        edgeLive[2 * from + slot] = 1;
+        edgeWork.push_back({to, from});
+    }
+
+    void visit(uint32_t index) {
+        const IRInstr& instr = function.code[index];
+        int32_t block = blockOf[index];
+        switch (instr.op) {
+            case IROp::Jump:
+                markEdge(block, 0);
+                return;
+            case IROp::Branch:
+                if (state[instr.a] == Lattice::Varying) {
+                    markEdge(block, 0);
+                    markEdge(block, 1);
+                } else if (state[instr.a] == Lattice::Constant) {
+                    markEdge(block, constant[instr.a] != 0 ? 0 : 1);
+                }
+                return;
+            case IROp::Const:
+                lower(instr.dest, Lattice::Constant, instr.a);
+                return;
+            case IROp::Phi: {
+                Lattice merged = Lattice::Unknown;
+                int32_t value = 0;
+                for (int32_t k = 0; k < instr.b && merged != Lattice::Varying; ++k) {
+                    const IRPhiArg& arg = function.phiArgs[instr.a + k];
+                    if (!edgeRuns(arg.block, block) || state[arg.value] == Lattice::Unknown) continue;
+                    if (state[arg.value] == Lattice::Varying ||
+                        (merged == Lattice::Constant && constant[arg.value] != value)) {
+                        merged = Lattice::Varying;
+                    } else {
+                        merged = Lattice::Constant;
+                        value = constant[arg.value];
+                    }
+                }
+                if (merged != Lattice::Unknown) lower(instr.dest, merged, value);
+                return;
+            }
+            default:
+                break;
+        }
+        if (instr.dest < 0) return;
+        if (instr.op == IROp::LoadGlobal || instr.op == IROp::StringValue) {
+            lower(instr.dest, Lattice::Varying);
+            return;
+        }
+        bool binary = isIRBinary(instr.op);
+        Lattice left = state[instr.a];
+        Lattice right = binary ? state[instr.b] : Lattice::Constant;
+        // x * 0 is 0 whatever x is
+        if (instr.op == IROp::Mul && ((left == Lattice::Constant && constant[instr.a] == 0) ||
+                                      (right == Lattice::Constant && constant[instr.b] == 0))) {
+            lower(instr.dest, Lattice::Constant, 0);
+            return;
+        }
+        if (left == Lattice::Varying || right == Lattice::Varying) {
+            lower(instr.dest, Lattice::Varying);
+        } else if (left == Lattice::Constant && right == Lattice::Constant) {
+            int32_t result;
+            if (evalIROp(instr.op, constant[instr.a], binary ? constant[instr.b] : 0, result)) {
+                lower(instr.dest, Lattice::Constant, result);
+            } else {
+                lower(instr.dest, Lattice::Varying); // Traps at runtime
+            }
+        }
+    }
+
+public:
+    explicit ConstantPropagation(IRFunction& function) : function(function) {}
+
+    void run(SSAStats& stats) {
+        size_t blockCount = function.blocks.size();
+        state.assign(function.valueCount(), Lattice::Unknown);
+        constant.assign(function.valueCount(), 0);
+        blockOf.assign(function.code.size(), 0);
+        for (size_t b = 0; b < blockCount; ++b) {
+            const IRBlock& block = function.blocks[b];
+            for (uint32_t i = block.begin; i < block.end; ++i) blockOf[i] = static_cast<int32_t>(b);
+        }
+        buildUses();
+        blockLive.assign(blockCount, 0);
+        edgeLive.assign(2 * blockCount, 0);
+
+        edgeWork.push_back({0, -1});
+        while (!edgeWork.empty() || !valueWork.empty()) {
+            while (!edgeWork.empty()) {
+                int32_t to = edgeWork.back().first;
+                edgeWork.pop_back();
+                const IRBlock& block = function.blocks[to];
+                if (!blockLive[to]) {
+                    blockLive[to] = 1;
+                    for (uint32_t i = block.begin; i < block.end; ++i) visit(i);
+                } else {
+                    // A new edge into a running block only changes its phis
+                    for (uint32_t i = block.begin; i < block.end && function.code[i].op == IROp::Phi; ++i) visit(i);
+                }
+            }
+            while (!valueWork.empty()) {
+                uint32_t i = valueWork.back();
+                valueWork.pop_back();
+                if (blockLive[blockOf[i]]) visit(i);
+            }
+        }
+
+        // Rewrite
+        for (size_t b = 0; b < blockCount; ++b) {
+            if (!blockLive[b]) continue;
+            IRBlock& block = function.blocks[b];
+            for (uint32_t i = block.begin; i < block.end; ++i) {
+                IRInstr& instr = function.code[i];
+                if (instr.dest >= 0 && instr.op != IROp::Const && state[instr.dest] == Lattice::Constant) {
+                    instr = {IROp::Const, instr.dest, constant[instr.dest], -1};
+                    stats.constants++;
+                }
+            }
+            IRInstr& last = function.code[block.end - 1];
+            if (last.op == IROp::Branch && state[last.a] == Lattice::Constant) {
+                int32_t target = block.succ[constant[last.a] != 0 ? 0 : 1];
+                last = {IROp::Jump, -1, -1, -1};
+                block.succ[0] = target;
+                block.succ[1] = -1;
+                stats.branchesFolded++;
+            }
+        }
+        size_t before = function.blocks.size();
+        packIR(function, unpackIR(function));
+        stats.blocksRemoved += static_cast<int>(before - function.blocks.size());
+    }
+};
+
+// Removes instructions whose results are never used and that have no side
+// effects, including phis that only feed each other
+int eliminateDeadIR(IRFunction& function) {
+    std::vector<uint8_t> live(function.valueCount(), 0);
+    std::vector<int32_t> defOf(function.valueCount(), -1);
+    std::vector<int32_t> worklist;
+    for (size_t i = 0; i < function.code.size(); ++i) {
+        const IRInstr& instr = function.code[i];
+        if (instr.dest >= 0) defOf[instr.dest] = static_cast<int32_t>(i);
+    }
+    auto markLive = [&](int32_t v) {
+        if (live[v]) return;
+        live[v] = 1;
+        if (defOf[v] >= 0) worklist.push_back(defOf[v]);
+    };
+    for (const IRInstr& instr : function.code) {
+        if (hasIRSideEffect(instr)) {
+            forEachIRUse(instr, markLive);
+            if (instr.dest >= 0) markLive(instr.dest);
+        }
+    }
+    while (!worklist.empty()) {
+        const IRInstr& instr = function.code[worklist.back()];
+        worklist.pop_back();
+        if (instr.op == IROp::Phi) {
+            for (int32_t k = 0; k < instr.b; ++k) markLive(function.phiArgs[instr.a + k].value);
+        } else {
+            forEachIRUse(instr, markLive);
+        }
+    }
+    int removed = 0;
+    for (IRInstr& instr : function.code) {
+        if (instr.dest >= 0 && !live[instr.dest]) {
+            instr = IRInstr();
+            removed++;
+        }
+    }
+    if (removed) packIR(function, unpackIR(function));
+    return removed;
+}
+
+#endif
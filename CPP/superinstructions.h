@@ -0,0 +1,243 @@
+#ifndef SUPERINSTRUCTIONS_H
+#define SUPERINSTRUCTIONS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "bytecode.h"
+#include "vm.h" // For OpcodeProfile
+
+// Adds the counts saved in a profile file to profile. Sequences are stored by
+// opcode name so a file survives changes to the opcode numbering; sequences
+// with unknown names are skipped. A missing file counts as empty; a count that
+// is not a number in range is an error naming the line.
+void loadOpcodeProfile(const std::string& path, OpcodeProfile& profile) {
+    std::ifstream file(path);
+    if (!file.is_open()) return;
+
+    std::unordered_map<std::string, int> opcodes;
+    for (int op = 0; op < OpcodeProfile::kinds; ++op) {
+        opcodes[opcodeName(static_cast<Opcode>(op))] = op;
+    }
+
+    std::string line;
+    for (int lineNumber = 1; std::getline(file, line); ++lineNumber) {
+        std::istringstream fields(line);
+        std::vector<std::string> names;
+        std::string field;
+        while (fields >> field) names.push_back(field);
+        if (names.size() < 3 || names[0][0] == '#') continue;
+
+        const std::string& countField = names.back();
+        uint64_t count = 0;
+        bool valid = countField.find_first_not_of("0123456789") == std::string::npos;
+        try {
+            if (valid) count = std::stoull(countField);
+        } catch (const std::out_of_range&) {
+            valid = false;
+        }
+        if (!valid) {
+            throw std::runtime_error("Bad count '" + countField + "' in profile " + path + " line " +
+                                     std::to_string(lineNumber));
+        }
+        names.pop_back();
+        int index = 0;
+        bool known = true;
+        for (size_t i = 1; i < names.size(); ++i) {
+            auto found = opcodes.find(names[i]);
+            if (found == opcodes.end()) {
+                known = false;
+                break;
+            }
+            index = index * OpcodeProfile::kinds + found->second;
+        }
+        if (!known) continue;
+        if (names[0] == "op" && names.size() == 2) profile.singles[index] += count;
+        if (names[0] == "pair" && names.size() == 3) profile.pairs[index] += count;
+        if (names[0] == "triple" && names.size() == 4) profile.triples[index] += count;
+    }
+}
+
+void saveOpcodeProfile(const std::string& path, const OpcodeProfile& profile) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not write profile: " + path);
+    }
+    const int kinds = OpcodeProfile::kinds;
+    auto name = [](int op) { return opcodeName(static_cast<Opcode>(op)); };
+    file << "# opcode profile: op/pair/triple, opcode names, count\n";
+    for (int a = 0; a < kinds; ++a) {
+        if (profile.singles[a]) file << "op " << name(a) << " " << profile.singles[a] << "\n";
+    }
+    for (int a = 0; a < kinds; ++a) {
+        for (int b = 0; b < kinds; ++b) {
+            uint64_t count = profile.pairs[a * kinds + b];
+            if (count) file << "pair " << name(a) << " " << name(b) << " " << count << "\n";
+        }
+    }
+    for (int a = 0; a < kinds; ++a) {
+        for (int b = 0; b < kinds; ++b) {
+            for (int c = 0; c < kinds; ++c) {
+                uint64_t count = profile.triples[(a * kinds + b) * kinds + c];
+                if (count) file << "triple " << name(a) << " " << name(b) << " " << name(c) << " " << count << "\n";
+            }
+        }
+    }
+}
+
+// Prints the most frequent pairs and triples with their share of all
+// dispatched instructions
+void printOpcodeProfile(const OpcodeProfile& profile, std::ostream& out, size_t limit = 10) {
+    const int kinds = OpcodeProfile::kinds;
+    uint64_t total = 0;
+    for (uint64_t count : profile.singles) total += count;
+    out << "  Instructions dispatched: " << total << "\n";
+    if (total == 0) return;
+
+    auto report = [&](const char* title, const std::vector<uint64_t>& counts, int length) {
+        std::vector<size_t> order;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            if (counts[i]) order.push_back(i);
+        }
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return counts[a] != counts[b] ? counts[a] > counts[b] : a < b;
+        });
+        out << "  Hottest " << title << ":\n";
+        for (size_t i = 0; i < std::min(limit, order.size()); ++i) {
+            std::string sequence;
+            size_t index = order[i];
+            for (int position = 0; position < length; ++position) {
+                std::string name = opcodeName(static_cast<Opcode>(index % kinds));
+                sequence = position == 0 ? name : name + " " + sequence;
+                index /= kinds;
+            }
+            out << "    " << std::setw(40) << std::left << sequence << std::setw(12) << std::right
+                << counts[order[i]] << std::fixed << std::setprecision(1) << std::setw(7)
+                << 100.0 * counts[order[i]] / total << "%\n" << std::defaultfloat << std::left;
+        }
+    };
+    report("pairs", profile.pairs, 2);
+    report("triples", profile.triples, 3);
+}
+
+// Rewrites hot instruction sequences into superinstructions. The sequences
+// come from --profile-ops runs over our loop benchmarks and test programs,
+// where these shapes made up most dispatches:
+//   LoadLocal a, Const k, Add|Sub, StoreLocal b   -> AddLocalConstStore a k b
+//   LoadLocal a, Const k, <cmp>, JumpIf* t        -> BranchLocal<cmp>Const a k t
+//   StoreLocal a, LoadLocal b                     -> StoreLocalLoadLocal a b
+//   LoadLocal a, Const k                          -> LoadLocalConst a k
+//   LoadLocal a, LoadLocal b                      -> LoadLocalLoadLocal a b
+// A sequence is only fused if no jump lands inside it. Returns the number of
+// superinstructions created.
+int fuseSuperinstructions(BytecodeModule& module) {
+    const std::vector<int32_t>& code = module.code;
+
+    // Instruction boundaries and jump targets of the unfused code
+    std::vector<size_t> starts;
+    std::vector<char> isTarget(code.size() + 1, 0);
+    for (size_t pc = 0; pc < code.size(); pc += 1 + opcodeOperands(static_cast<Opcode>(code[pc]))) {
+        starts.push_back(pc);
+        int jump = opcodeJumpOperand(static_cast<Opcode>(code[pc]));
+        if (jump >= 0) isTarget[code[pc + 1 + jump]] = 1;
+    }
+
+    auto op = [&](size_t i) {
+        return i < starts.size() ? static_cast<Opcode>(code[starts[i]]) : Opcode::Count;
+    };
+    auto operand = [&](size_t i, int index) { return code[starts[i] + 1 + index]; };
+    // Whether instructions i+1 .. i+length-1 can be absorbed into instruction i
+    auto fusable = [&](size_t i, size_t length) {
+        if (i + length > starts.size()) return false;
+        for (size_t j = i + 1; j < i + length; ++j) {
+            if (isTarget[starts[j]]) return false;
+        }
+        return true;
+    };
+    auto comparison = [](Opcode cmp, bool whenTrue) {
+        // Branching when the comparison is false is branching on its inverse
+        switch (cmp) {
+            case Opcode::Eq: return whenTrue ? Opcode::BranchLocalEqConst : Opcode::BranchLocalNeConst;
+            case Opcode::Ne: return whenTrue ? Opcode::BranchLocalNeConst : Opcode::BranchLocalEqConst;
+            case Opcode::Lt: return whenTrue ? Opcode::BranchLocalLtConst : Opcode::BranchLocalGeConst;
+            case Opcode::Le: return whenTrue ? Opcode::BranchLocalLeConst : Opcode::BranchLocalGtConst;
+            case Opcode::Gt: return whenTrue ? Opcode::BranchLocalGtConst : Opcode::BranchLocalLeConst;
+            case Opcode::Ge: return whenTrue ? Opcode::BranchLocalGeConst : Opcode::BranchLocalLtConst;
+            default: return Opcode::Count;
+        }
+    };
+    auto loadAddStore = [&](size_t i) {
+        return op(i) == Opcode::LoadLocal && op(i + 1) == Opcode::Const &&
+               (op(i + 2) == Opcode::Add || op(i + 2) == Opcode::Sub) && op(i + 3) == Opcode::StoreLocal &&
+               fusable(i, 4);
+    };
+    auto compareBranch = [&](size_t i) {
+        return op(i) == Opcode::LoadLocal && op(i + 1) == Opcode::Const &&
+               comparison(op(i + 2), true) != Opcode::Count &&
+               (op(i + 3) == Opcode::JumpIfTrue || op(i + 3) == Opcode::JumpIfFalse) && fusable(i, 4);
+    };
+
+    std::vector<int32_t> fused;
+    std::vector<int32_t> newPosition(code.size() + 1, -1);
+    std::vector<size_t> jumpOperands; // Positions in fused still holding old targets
+    int created = 0;
+
+    auto emit = [&](Opcode opcode, std::initializer_list<int32_t> operands, int jumpOperand = -1) {
+        fused.push_back(static_cast<int32_t>(opcode));
+        int index = 0;
+        for (int32_t value : operands) {
+            if (index++ == jumpOperand) jumpOperands.push_back(fused.size());
+            fused.push_back(value);
+        }
+    };
+
+    for (size_t i = 0; i < starts.size();) {
+        newPosition[starts[i]] = static_cast<int32_t>(fused.size());
+        size_t length = 1;
+        if (loadAddStore(i)) {
+            int32_t constant = module.constants[operand(i + 1, 0)];
+            if (op(i + 2) == Opcode::Sub) constant = wrapNeg(constant);
+            emit(Opcode::AddLocalConstStore, {operand(i, 0), constant, operand(i + 3, 0)});
+            length = 4;
+        } else if (compareBranch(i)) {
+            Opcode branch = comparison(op(i + 2), op(i + 3) == Opcode::JumpIfTrue);
+            emit(branch, {operand(i, 0), module.constants[operand(i + 1, 0)], operand(i + 3, 0)}, 2);
+            length = 4;
+        } else if (op(i) == Opcode::StoreLocal && op(i + 1) == Opcode::LoadLocal && fusable(i, 2) &&
+                   !loadAddStore(i + 1) && !compareBranch(i + 1)) {
+            emit(Opcode::StoreLocalLoadLocal, {operand(i, 0), operand(i + 1, 0)});
+            length = 2;
+        } else if (op(i) == Opcode::LoadLocal && op(i + 1) == Opcode::Const && fusable(i, 2)) {
+            emit(Opcode::LoadLocalConst, {operand(i, 0), module.constants[operand(i + 1, 0)]});
+            length = 2;
+        } else if (op(i) == Opcode::LoadLocal && op(i + 1) == Opcode::LoadLocal && fusable(i, 2)) {
+            emit(Opcode::LoadLocalLoadLocal, {operand(i, 0), operand(i + 1, 0)});
+            length = 2;
+        } else {
+            Opcode opcode = op(i);
+            int jump = opcodeJumpOperand(opcode);
+            fused.push_back(code[starts[i]]);
+            for (int j = 0; j < opcodeOperands(opcode); ++j) {
+                if (j == jump) jumpOperands.push_back(fused.size());
+                fused.push_back(operand(i, j));
+            }
+        }
+        if (length > 1) created++;
+        i += length;
+    }
+
+    for (size_t position : jumpOperands) {
+        fused[position] = newPosition[fused[position]];
+    }
+    module.code = std::move(fused);
+    return created;
+}
+
+#endif
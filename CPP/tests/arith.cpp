@@ -0,0 +1,23 @@
+// Wrapping int arithmetic, comparisons, logic and chars
+// expect: exit 0
+int g = 7;
+int main() {
+    int big = 2147483647;
+    int wrapped = big + 1;
+    int product = 65536 * 65536 + 46341 * 46341;
+    int h = 0;
+    for (int i = 0; i < 40; i = i + 1) {
+        h = h * 31 + i * 17 - (i / 3) * 5;
+    }
+    char c = 'z';
+    int logic = (3 < 4) + (4 <= 4) * 2 + (5 > 6) * 4 + (g >= 7) * 8 + (g == 7) * 16 + (g != 7) * 32;
+    int neg = -g / 2 + -(-g) / -3 + !g + !!g + !0;
+    int check = 0;
+    if (wrapped != -big - 1) { check = check + 1; }
+    if (product != -2147479015) { check = check + 2; }
+    if (h != -410310415) { check = check + 4; }
+    if (c - 'a' != 25) { check = check + 8; }
+    if (logic != 27) { check = check + 16; }
+    if (neg != -3) { check = check + 32; }
+    return check;
+}
@@ -0,0 +1,62 @@
+#!/bin/bash
+# Differential test: runs every tests/*.cpp program on each --run engine and
+# compares the result with the expectations in the program's header:
+#   // expect: exit N           main returns N (native and c: N modulo 256)
+#   // expect: error MESSAGE    the run fails with "Runtime Error: MESSAGE" and
+#                               reports no exit code
+#   // expect-no-output: TEXT   TEXT appears nowhere in the compiler's output
+# Usage: tests/check.sh [path/to/compiler]
+
+compiler=${1:-./compiler}
+dir=$(dirname "$0")
+engines="ast closure vm reg ir jit tiered native c"
+failures=0
+count=0
+passed=0
+
+fail() {
+    echo "FAIL $1: $2"
+    failures=$((failures + 1))
+    ok=0
+}
+
+for program in "$dir"/*.cpp; do
+    name=$(basename "$program" .cpp)
+    expected=$(sed -n 's|^// expect: ||p' "$program")
+    forbidden=$(sed -n 's|^// expect-no-output: ||p' "$program")
+    if [ -z "$expected" ]; then
+        fail "$name" "no '// expect:' line"
+        continue
+    fi
+    for engine in $engines; do
+        count=$((count + 1))
+        ok=1
+        output=$("$compiler" --run="$engine" "$program" 2>&1)
+        case "$expected" in
+            "exit "*)
+                want=${expected#exit }
+                if [ "$engine" = native ] || [ "$engine" = c ]; then
+                    want=$(((want % 256 + 256) % 256))
+                fi
+                got=$(echo "$output" | sed -n 's|^  Exit code: ||p')
+                [ "$got" = "$want" ] || fail "$name ($engine)" "expected exit $want, got '${got:-no exit code}'"
+                ;;
+            "error "*)
+                if ! echo "$output" | grep -qF "Runtime Error: ${expected#error }" ||
+                    echo "$output" | grep -q "^  Exit code:"; then
+                    fail "$name ($engine)" "expected runtime error '${expected#error }'"
+                fi
+                ;;
+            *)
+                fail "$name" "unknown expectation '$expected'"
+                ;;
+        esac
+        if [ -n "$forbidden" ] && echo "$output" | grep -qF "$forbidden"; then
+            fail "$name ($engine)" "output contains '$forbidden'"
+        fi
+        passed=$((passed + ok))
+    done
+done
+
+echo "$passed of $count runs passed"
+[ "$failures" -eq 0 ]
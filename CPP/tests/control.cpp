@@ -0,0 +1,25 @@
+// Nested branches and loops, short-circuit operators with assignments
+// expect: exit 1179
+int count;
+int main() {
+    int s = 0;
+    int a = 0;
+    int b = 0;
+    for (int i = 0; i < 30; i = i + 1) {
+        int j = i;
+        while (j > 0) {
+            int r = j - j / 3 * 3;
+            if (r == 0) {
+                s = s + j;
+            } else if (r == 1) {
+                s = s - 1;
+            } else {
+                count = count + 1;
+            }
+            j = j - 4;
+        }
+        if (i > 10 && (a = a + 1) > 5) { b = b + 1; }
+        if (i < 5 || (a = a + 2) < 0) { b = b + 10; }
+    }
+    return s + count + a * 10 + b;
+}
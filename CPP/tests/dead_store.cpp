@@ -0,0 +1,9 @@
+// Regression: a store read later in the same expression is not dead
+// expect: exit 10
+// expect-no-output: value assigned to 'x'
+int main() {
+    int x;
+    int y = 0;
+    y = (x = 5) + x;
+    return y;
+}
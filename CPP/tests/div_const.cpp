@@ -0,0 +1,21 @@
+// Regression: division by constants, rewritten as a multiply by a magic
+// number, must round toward zero for every dividend, including INT_MIN and
+// INT_MAX, and for negative, power-of-two and extreme divisors
+// expect: exit 0
+int main() {
+    int h = 0;
+    int x = -2147483647 - 1;
+    int n = 0;
+    while (n < 64) {
+        h = h * 31 + x / 2 + x / 3 + x / 7 + x / 10 + x / 641;
+        h = h * 31 + x / -1 + x / -3 + x / -8 + x / -1000;
+        h = h * 31 + x / 65536 + x / 2147483647 + x / (-2147483647 - 1) + x / 1;
+        x = x + 67108863 + n;
+        n = n + 1;
+    }
+    x = 2147483647;
+    h = h * 31 + x / 3 + x / -7 + x / 1000000;
+    int y = -2147483647 - 1;
+    h = h * 31 + y / 3 + y / -7 + y / 1000000 + y / -1;
+    return h - 431476574;
+}
@@ -0,0 +1,9 @@
+// Regression: INT_MIN / -1 wraps to INT_MIN instead of trapping, whether
+// the divisor is a variable or a constant
+// expect: exit -192
+int main() {
+    int m = -2147483647 - 1;
+    int d = -1;
+    int q = m / d;
+    return q / 16777216 + m / -1 / 33554432;
+}
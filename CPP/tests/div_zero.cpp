@@ -0,0 +1,8 @@
+// Dividing by a variable that is zero is a runtime error on every engine
+// expect: error Division by zero
+int g = 3;
+int main() {
+    int x = 0;
+    int y = g / x;
+    return y;
+}
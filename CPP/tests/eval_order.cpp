@@ -0,0 +1,14 @@
+// Operands evaluate left to right, seeing assignments made earlier in the
+// same expression
+// expect: exit 198
+int g = 2;
+int main() {
+    int x = 1;
+    int y = x + (x = 10) * 3;
+    int z = (x = 4) - x;
+    for (int i = 0; i < 3; i = i + 1) {
+        z = z + (y = y + i);
+    }
+    char c = 'A';
+    return y + z + c + g;
+}
@@ -0,0 +1,17 @@
+// Enough back edges for the tiered engine to compile the loops, and a
+// return from inside them
+// expect: exit 2000004066
+int g = 0;
+int main() {
+    int s = 0;
+    for (int i = 0; i < 100000; i = i + 1) {
+        int j = 0;
+        while (j < 10) {
+            s = s + i * j;
+            j = j + 1;
+            if (s > 2000000000) { return s - i; }
+        }
+        g = g + 1;
+    }
+    return 7;
+}
@@ -0,0 +1,23 @@
+// Induction variables counting up and down, and nested loops with a
+// variable bound
+// expect: exit 32486
+int g;
+int main() {
+    int s = 0;
+    for (int j = 0; j < 3; j = j + 1) {
+        s = s + j * 12 + j / 3;
+    }
+    int i = 100;
+    while (i > 4) {
+        g = g + i * 7 - i / -5 + i / 1;
+        i = i - 3;
+    }
+    int k = 0;
+    while (k <= 50) {
+        int t = 0;
+        for (int m = 0; m < k; m = m + 1) { t = t + m * k; }
+        s = s + t / 10;
+        k = k + 5;
+    }
+    return s + g;
+}
@@ -0,0 +1,17 @@
+// Loop-invariant expressions, a guarded division and a global stored in a
+// later loop
+// expect: exit 26130
+int g;
+int main() {
+    int n = 7;
+    int s = 0;
+    int i = 0;
+    while (i < 1000) {
+        int k = n * 3 + g;
+        if (i > 500) { s = s + k / 2; }
+        s = s + n * 3;
+        i = i + 1;
+    }
+    for (int j = 0; j < 10; j = j + 1) { g = g + n * 2; }
+    return s + g;
+}
@@ -0,0 +1,8 @@
+// Using a string as a value is a runtime error on every engine, reported
+// the same way by the ones that run a separate executable
+// expect: error String values are not supported at runtime
+int main() {
+    int x = 0;
+    if (x) { return 2; }
+    return x + "a";
+}
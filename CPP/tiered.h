@@ -0,0 +1,113 @@
+#ifndef TIERED_H
+#define TIERED_H
+
+#include <cstdint>
+#include <unordered_map>
+#include "parser.h" // For ASTNode
+#include "interpreter.h"
+#include "jit.h"
+#include "perfmap.h"
+#include "x86.h"
+#include "x86encode.h"
+
+struct TierStats {
+    int loopsCompiled = 0;
+    uint64_t osrEntries = 0;    // Transfers from the interpreter in the middle of a loop
+    uint64_t nativeEntries = 0; // Later entries that start in compiled code
+};
+
+// Starts every program in the AST interpreter and counts back edges on each
+// WHILE and FOR node. When a loop's count reaches the threshold it is
+// compiled to x86-64 on its own, and execution moves into the compiled code
+// at the loop condition, taking the live frame with it (on-stack
+// replacement). The compiled loop writes the frame back when it exits, and
+// later entries to the loop go straight to native code.
+class TieredInterpreter : public BasicInterpreter<TieredInterpreter> {
+public:
+    using LoopEntry = int32_t (*)(int32_t* frame, int32_t* globals, int32_t* status);
+
+private:
+    struct LoopState {
+        uint32_t backEdges = 0;
+        LoopEntry entry = nullptr;
+    };
+
+    uint32_t threshold;
+    std::unordered_map<const ASTNode*, LoopState> loops;
+    ExecutableMemory memory;
+    TierStats& stats;
+    PerfMap* perfMap;
+
+    LoopEntry compileLoop(ASTNode* node) {
+        std::vector<uint8_t> code = encodeX86(compileX86Loop(program, currentFunction, node)).bytes;
+        stats.loopsCompiled++;
+        const uint8_t* address = memory.install(code);
+        if (perfMap) perfMap->add(perfMap->symbolName(currentFunction, node), address, code.size());
+        return reinterpret_cast<LoopEntry>(const_cast<uint8_t*>(address));
+    }
+
+    // Runs a compiled loop from its condition to its exit
+    void enterNative(LoopEntry entry) {
+        int32_t status = 0;
+        int32_t value = entry(frame.data(), globals.data(), &status);
+        if (status == kX86Returned) {
+            returning = true;
+            returnValue = value;
+            return;
+        }
+        checkX86Status(status);
+    }
+
+    // Counts a back edge; once the loop is hot, finishes it in native code
+    // and returns true
+    bool backEdge(LoopState& state, ASTNode* node) {
+        if (++state.backEdges < threshold) return false;
+        state.entry = compileLoop(node);
+        stats.osrEntries++;
+        enterNative(state.entry);
+        return true;
+    }
+
+public:
+    TieredInterpreter(uint32_t threshold, TierStats& stats, PerfMap* perfMap = nullptr)
+        : threshold(threshold), stats(stats), perfMap(perfMap) {}
+
+    int32_t visitWhile(ASTNode* node) {
+        LoopState& state = loops[node];
+        if (state.entry) {
+            stats.nativeEntries++;
+            enterNative(state.entry);
+            return 0;
+        }
+        while (!returning && visit(node->children[0]) != 0) {
+            visit(node->children[1]);
+            if (returning || backEdge(state, node)) break;
+        }
+        return 0;
+    }
+
+    int32_t visitFor(ASTNode* node) {
+        LoopState& state = loops[node];
+        visit(node->children[0]);
+        if (state.entry) {
+            stats.nativeEntries++;
+            enterNative(state.entry);
+            return 0;
+        }
+        while (visit(node->children[1]) != 0) {
+            visit(node->children[3]);
+            if (returning) break;
+            visit(node->children[2]);
+            if (backEdge(state, node)) break;
+        }
+        return 0;
+    }
+};
+
+// Runs a resolved PROGRAM with tiering and returns main's exit code
+int32_t runTiered(ASTNode* program, uint32_t threshold, TierStats& stats, PerfMap* perfMap = nullptr) {
+    TieredInterpreter interpreter(threshold, stats, perfMap);
+    return interpreter.run(program);
+}
+
+#endif
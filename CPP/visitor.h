@@ -0,0 +1,92 @@
+#ifndef VISITOR_H
+#define VISITOR_H
+
+#include "parser.h" // For ASTNode and NodeKind
+
+// CRTP visitor over the AST. visit() is a single switch on the node kind that
+// calls the matching visitXxx hook on the derived pass; hooks a pass does not
+// override fall through to visitDefault, which visits every child in order.
+template <typename Derived, typename Result = void>
+class ASTVisitor {
+protected:
+    Derived& derived() { return static_cast<Derived&>(*this); }
+
+public:
+    Result visit(ASTNode* node) {
+        if (!node) return Result();
+
+        switch (node->kind) {
+            case NodeKind::Program:         return derived().visitProgram(node);
+            case NodeKind::Include:         return derived().visitInclude(node);
+            case NodeKind::Function:        return derived().visitFunction(node);
+            case NodeKind::ReturnType:      return derived().visitReturnType(node);
+            case NodeKind::Block:           return derived().visitBlock(node);
+            case NodeKind::DeclarationInt:  return derived().visitDeclarationInt(node);
+            case NodeKind::DeclarationChar: return derived().visitDeclarationChar(node);
+            case NodeKind::If:              return derived().visitIf(node);
+            case NodeKind::While:           return derived().visitWhile(node);
+            case NodeKind::For:             return derived().visitFor(node);
+            case NodeKind::Return:          return derived().visitReturn(node);
+            case NodeKind::Assignment:      return derived().visitAssignment(node);
+            case NodeKind::BinOp:           return derived().visitBinOp(node);
+            case NodeKind::ComparisonOp:    return derived().visitComparisonOp(node);
+            case NodeKind::LogicalOp:       return derived().visitLogicalOp(node);
+            case NodeKind::UnaryOp:         return derived().visitUnaryOp(node);
+            case NodeKind::Number:          return derived().visitNumber(node);
+            case NodeKind::Char:            return derived().visitChar(node);
+            case NodeKind::String:          return derived().visitString(node);
+            case NodeKind::Identifier:      return derived().visitIdentifier(node);
+            case NodeKind::Unknown:         break;
+        }
+        return derived().visitDefault(node);
+    }
+
+    void visitChildren(ASTNode* node) {
+        for (ASTNode* child : node->children) {
+            visit(child);
+        }
+    }
+
+    Result visitDefault(ASTNode* node) {
+        visitChildren(node);
+        return Result();
+    }
+
+    Result visitProgram(ASTNode* node)         { return derived().visitDefault(node); }
+    Result visitInclude(ASTNode* node)         { return derived().visitDefault(node); }
+    Result visitFunction(ASTNode* node)        { return derived().visitDefault(node); }
+    Result visitReturnType(ASTNode* node)      { return derived().visitDefault(node); }
+    Result visitBlock(ASTNode* node)           { return derived().visitDefault(node); }
+    Result visitDeclarationInt(ASTNode* node)  { return derived().visitDefault(node); }
+    Result visitDeclarationChar(ASTNode* node) { return derived().visitDefault(node); }
+    Result visitIf(ASTNode* node)              { return derived().visitDefault(node); }
+    Result visitWhile(ASTNode* node)           { return derived().visitDefault(node); }
+    Result visitFor(ASTNode* node)             { return derived().visitDefault(node); }
+    Result visitReturn(ASTNode* node)          { return derived().visitDefault(node); }
+    Result visitAssignment(ASTNode* node)      { return derived().visitDefault(node); }
+    Result visitBinOp(ASTNode* node)           { return derived().visitDefault(node); }
+    Result visitComparisonOp(ASTNode* node)    { return derived().visitDefault(node); }
+    Result visitLogicalOp(ASTNode* node)       { return derived().visitDefault(node); }
+    Result visitUnaryOp(ASTNode* node)         { return derived().visitDefault(node); }
+    Result visitNumber(ASTNode* node)          { return derived().visitDefault(node); }
+    Result visitChar(ASTNode* node)            { return derived().visitDefault(node); }
+    Result visitString(ASTNode* node)          { return derived().visitDefault(node); }
+    Result visitIdentifier(ASTNode* node)      { return derived().visitDefault(node); }
+};
+
+// Counts every node kind in one traversal
+class NodeCounter : public ASTVisitor<NodeCounter> {
+public:
+    int counts[NODE_KIND_COUNT] = {};
+
+    void visitDefault(ASTNode* node) {
+        counts[static_cast<int>(node->kind)]++;
+        visitChildren(node);
+    }
+
+    int count(NodeKind kind) const {
+        return counts[static_cast<int>(kind)];
+    }
+};
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef VM_H
+#define VM_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "bytecode.h"
+#include "arith.h"
+
+// Computed-goto (direct-threaded) dispatch needs the GNU labels-as-values
+// extension; other compilers, or -DBYTECODE_SWITCH_DISPATCH, use a switch
+#if defined(__GNUC__) && !defined(BYTECODE_SWITCH_DISPATCH)
+#define BYTECODE_COMPUTED_GOTO 1
+#endif
+
+// Dynamic counts of opcodes, and of opcode pairs and triples that run back
+// to back with no jump between them, which a peephole pass could fuse
+struct OpcodeProfile {
+    static constexpr int kinds = static_cast<int>(Opcode::Count);
+    std::vector<uint64_t> singles = std::vector<uint64_t>(kinds, 0);
+    std::vector<uint64_t> pairs = std::vector<uint64_t>(kinds * kinds, 0);
+    std::vector<uint64_t> triples = std::vector<uint64_t>(kinds * kinds * kinds, 0);
+    int previous = -1;       // Opcode before this one, or -1 after a jump
+    int beforePrevious = -1;
+    const int32_t* fallthrough = nullptr;
+
+    void record(const int32_t* pc) {
+        int op = *pc;
+        if (pc != fallthrough) {
+            previous = beforePrevious = -1;
+        }
+        singles[op]++;
+        if (previous >= 0) pairs[previous * kinds + op]++;
+        if (beforePrevious >= 0) triples[(beforePrevious * kinds + previous) * kinds + op]++;
+        beforePrevious = previous;
+        previous = op;
+        fallthrough = pc + 1 + opcodeOperands(static_cast<Opcode>(op));
+    }
+};
+
+// Runs bytecode starting at code[0] until a Return and yields its value.
+// The stack must hold maxStack + 1 values; globals and frame must be
+// sized and zeroed by the caller. With Profiling every dispatched
+// instruction is recorded in profile.
+template <bool Profiling>
+int32_t executeBytecode(const int32_t* code, const int32_t* constants, int32_t* globals,
+                        int32_t* frame, int32_t* stack, OpcodeProfile* profile) {
+    const int32_t* pc = code;
+    // The top of the stack is cached in a local; sp points one past the
+    // value below it. Pushing onto an empty stack spills a dummy value.
+    int32_t top = 0;
+    int32_t* sp = stack;
+    int32_t condition;
+
+#ifdef BYTECODE_COMPUTED_GOTO
+    static void* const labels[] = {
+#define BYTECODE_LABEL(name, operands) &&op_##name,
+        BYTECODE_OPCODES(BYTECODE_LABEL)
+#undef BYTECODE_LABEL
+    };
+#define CASE(name) op_##name:
+#define NEXT()                           \
+    do {                                 \
+        if (Profiling) profile->record(pc); \
+        goto *labels[*pc++];             \
+    } while (0)
+    NEXT();
+#else
+#define CASE(name) case Opcode::name:
+#define NEXT() goto dispatch
+dispatch:
+    if (Profiling) profile->record(pc);
+    switch (static_cast<Opcode>(*pc++)) {
+#endif
+
+    CASE(Const)       *sp++ = top; top = constants[*pc++]; NEXT();
+    CASE(LoadLocal)   *sp++ = top; top = frame[*pc++]; NEXT();
+    CASE(StoreLocal)  frame[*pc++] = top; top = *--sp; NEXT();
+    CASE(LoadGlobal)  *sp++ = top; top = globals[*pc++]; NEXT();
+    CASE(StoreGlobal) globals[*pc++] = top; top = *--sp; NEXT();
+    CASE(Dup)         *sp++ = top; NEXT();
+    CASE(Pop)         top = *--sp; NEXT();
+    CASE(Add)         top = wrapAdd(*--sp, top); NEXT();
+    CASE(Sub)         top = wrapSub(*--sp, top); NEXT();
+    CASE(Mul)         top = wrapMul(*--sp, top); NEXT();
+    CASE(Div)
+        if (top == 0) throw std::runtime_error("Division by zero");
+        top = wrapDiv(*--sp, top);
+        NEXT();
+    CASE(Neg)         top = wrapNeg(top); NEXT();
+    CASE(Not)         top = top == 0; NEXT();
+    CASE(Eq)          top = *--sp == top; NEXT();
+    CASE(Ne)          top = *--sp != top; NEXT();
+    CASE(Lt)          top = *--sp < top; NEXT();
+    CASE(Le)          top = *--sp <= top; NEXT();
+    CASE(Gt)          top = *--sp > top; NEXT();
+    CASE(Ge)          top = *--sp >= top; NEXT();
+    CASE(Jump)        pc = code + *pc; NEXT();
+    CASE(JumpIfFalse) condition = top; top = *--sp; pc = condition == 0 ? code + *pc : pc + 1; NEXT();
+    CASE(JumpIfTrue)  condition = top; top = *--sp; pc = condition != 0 ? code + *pc : pc + 1; NEXT();
+    CASE(Return)      return top;
+    CASE(Trap)        throw std::runtime_error("String values are not supported at runtime");
+
+#define BRANCH_LOCAL_CONST(name, cmp) \
+    CASE(name) pc = frame[pc[0]] cmp pc[1] ? code + pc[2] : pc + 3; NEXT();
+
+    CASE(AddLocalConstStore) frame[pc[2]] = wrapAdd(frame[pc[0]], pc[1]); pc += 3; NEXT();
+    BRANCH_LOCAL_CONST(BranchLocalEqConst, ==)
+    BRANCH_LOCAL_CONST(BranchLocalNeConst, !=)
+    BRANCH_LOCAL_CONST(BranchLocalLtConst, <)
+    BRANCH_LOCAL_CONST(BranchLocalLeConst, <=)
+    BRANCH_LOCAL_CONST(BranchLocalGtConst, >)
+    BRANCH_LOCAL_CONST(BranchLocalGeConst, >=)
+    CASE(StoreLocalLoadLocal) frame[pc[0]] = top; top = frame[pc[1]]; pc += 2; NEXT();
+    CASE(LoadLocalConst)      *sp++ = top; *sp++ = frame[pc[0]]; top = pc[1]; pc += 2; NEXT();
+    CASE(LoadLocalLoadLocal)  *sp++ = top; *sp++ = frame[pc[0]]; top = frame[pc[1]]; pc += 2; NEXT();
+#undef BRANCH_LOCAL_CONST
+
+#ifndef BYTECODE_COMPUTED_GOTO
+    default:
+        break;
+    }
+    throw std::runtime_error("Invalid opcode");
+#endif
+#undef CASE
+#undef NEXT
+}
+
+int32_t executeBytecode(const int32_t* code, const int32_t* constants,
+                        int32_t* globals, int32_t* frame, int32_t* stack) {
+    return executeBytecode<false>(code, constants, globals, frame, stack, nullptr);
+}
+
+// Runs a compiled module and returns main's exit code, recording executed
+// instructions in profile if one is given
+int32_t runBytecode(const BytecodeModule& module, OpcodeProfile* profile = nullptr) {
+    std::vector<int32_t> globals(module.globalCount, 0);
+    std::vector<int32_t> frame(module.frameSize, 0);
+    std::vector<int32_t> stack(module.maxStack + 1, 0);
+    if (profile) {
+        return executeBytecode<true>(module.code.data(), module.constants.data(), globals.data(), frame.data(),
+                                     stack.data(), profile);
+    }
+    return executeBytecode(module.code.data(), module.constants.data(), globals.data(), frame.data(), stack.data());
+}
+
+#endif
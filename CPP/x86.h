@@ -0,0 +1,694 @@
+#ifndef X86_H
+#define X86_H
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "parser.h" // For ASTNode
+#include "constfold.h" // For constantValue
+#include "interpreter.h" // For findMainFunction
+
+// x86-64 general purpose registers, numbered as in the instruction encoding
+enum class X86Reg : uint8_t { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+// Condition codes, numbered as in the Jcc/SETcc encodings
+enum class X86Cond : uint8_t { E = 0x4, NE = 0x5, L = 0xC, GE = 0xD, LE = 0xE, G = 0xF };
+
+X86Cond invertCondition(X86Cond cond) {
+    return static_cast<X86Cond>(static_cast<uint8_t>(cond) ^ 1);
+}
+
+struct X86Operand {
+    enum class Kind : uint8_t { None, Reg, Imm, Mem, Local, Label };
+    Kind kind = Kind::None;
+    X86Reg reg = X86Reg::RAX; // The register, or the base of a memory operand
+    int32_t value = 0;        // Immediate, displacement, local slot or label id
+
+    static X86Operand r(X86Reg reg) { return {Kind::Reg, reg, 0}; }
+    static X86Operand imm(int32_t value) { return {Kind::Imm, X86Reg::RAX, value}; }
+    static X86Operand mem(X86Reg base, int32_t displacement) { return {Kind::Mem, base, displacement}; }
+    static X86Operand local(int slot) { return {Kind::Local, X86Reg::RAX, slot}; }
+    static X86Operand label(int id) { return {Kind::Label, X86Reg::RAX, id}; }
+
+    bool isReg() const { return kind == Kind::Reg; }
+    bool isImm() const { return kind == Kind::Imm; }
+    bool isMem() const { return kind == Kind::Mem; }
+    bool is(X86Reg other) const { return kind == Kind::Reg && reg == other; }
+};
+
+// Machine instructions. Arithmetic is on 32-bit registers; the *64 forms,
+// Push and Pop work on full registers and only appear in the prologue,
+// epilogue, trap stubs and temporary spills. Set writes AL.
+enum class X86Op : uint8_t {
+    Label, Mov, Add, Sub, Imul, Neg, Cmp, Set, MovzxAL, Cdq, Idiv,
+    Jmp, Jcc, Push, Pop, Mov64, Sub64, Ret
+};
+
+struct X86Instr {
+    X86Op op;
+    X86Cond cond = X86Cond::E;
+    X86Operand a, b;
+};
+
+// A compiled function with the signature
+//     int32_t function(int32_t* globals, int32_t* status)
+// Globals are addressed off r15. A runtime error stores a nonzero status
+// (kX86DivideByZero or kX86StringValue) and returns. A compiled loop (see
+// compileX86Loop) instead has the signature
+//     int32_t loop(int32_t* frame, int32_t* globals, int32_t* status)
+// and stores kX86Returned when a RETURN inside it ran.
+struct X86Function {
+    std::string name;
+    std::vector<X86Instr> code;
+    int labelCount = 0;
+    int32_t globalCount = 0;
+    int32_t frameSize = 0;
+    std::vector<std::string> localNames;     // By slot
+    std::vector<X86Operand> localLocations;  // By slot: a register, a stack slot, or None if unused
+};
+
+const int32_t kX86DivideByZero = 1;
+const int32_t kX86StringValue = 2;
+const int32_t kX86Returned = 3;
+
+// Frame layout below rbp: the five saved callee-saved registers, the status
+// pointer, the interpreter frame pointer (compiled loops only), then one
+// 4-byte slot per spilled local
+const int32_t kX86SavedBytes = 40;
+const int32_t kX86StatusOffset = -48;
+const int32_t kX86FrameOffset = -56;
+
+int32_t x86LocalOffset(int slot) { return kX86FrameOffset - 4 * (slot + 1); }
+
+// Lowers the resolved AST of a function (for main, preceded by the global
+// initializers) to machine instructions. Expression temporaries live in a small stack of scratch
+// registers (spilling to the machine stack when it runs out); locals are
+// left as Local operands for the register allocator. eax and edx are kept
+// free for division and as scratch for legalization.
+class X86CodeGen {
+private:
+    static constexpr X86Reg temps[] = {X86Reg::RCX, X86Reg::RSI, X86Reg::RDI, X86Reg::R8};
+    static constexpr int tempCount = 4;
+
+    X86Function function;
+    int epilogue = 0;
+    bool inLoop = false; // Compiling a single loop for on-stack replacement
+    int divideByZero = 0;
+    int stringValue = 0;
+
+    int newLabel() { return function.labelCount++; }
+
+    void emit(X86Op op, X86Operand a = {}, X86Operand b = {}) {
+        function.code.push_back({op, X86Cond::E, a, b});
+    }
+
+    void emitJcc(X86Cond cond, int label) {
+        function.code.push_back({X86Op::Jcc, cond, X86Operand::label(label), {}});
+    }
+
+    void bind(int label) { emit(X86Op::Label, X86Operand::label(label)); }
+
+    static X86Operand temp(int depth) { return X86Operand::r(temps[depth]); }
+
+    X86Operand variable(const ASTNode* node) {
+        if (node->isGlobal) return X86Operand::mem(X86Reg::R15, 4 * node->slot);
+        return X86Operand::local(node->slot);
+    }
+
+    // Operands that can be used directly without evaluating anything
+    bool simpleOperand(const ASTNode* node, X86Operand& operand) {
+        int32_t value;
+        if (constantValue(node, value)) {
+            operand = X86Operand::imm(value);
+            return true;
+        }
+        if (node->kind == NodeKind::Identifier) {
+            operand = variable(node);
+            return true;
+        }
+        return false;
+    }
+
+    static X86Cond comparison(const std::string& op) {
+        if (op == "==") return X86Cond::E;
+        if (op == "!=") return X86Cond::NE;
+        if (op == "<") return X86Cond::L;
+        if (op == "<=") return X86Cond::LE;
+        if (op == ">") return X86Cond::G;
+        return X86Cond::GE;
+    }
+
+    // Evaluates both operands of a binary node. The left one ends up in
+    // `left` and the right one in `right`, which may be an immediate or a
+    // variable when it needs no evaluation.
+    void genOperands(ASTNode* node, int depth, X86Operand& left, X86Operand& right, bool rightInRegister) {
+        genExpression(node->children[0], depth);
+        left = temp(depth);
+        X86Operand operand;
+        if (simpleOperand(node->children[1], operand) && !(rightInRegister && operand.isImm())) {
+            right = operand;
+        } else if (depth + 1 < tempCount) {
+            genExpression(node->children[1], depth + 1);
+            right = temp(depth + 1);
+        } else {
+            // Out of scratch registers: park the left value on the stack
+            emit(X86Op::Push, left);
+            genExpression(node->children[1], depth);
+            right = temp(depth);
+            emit(X86Op::Pop, X86Operand::r(X86Reg::RAX));
+            left = X86Operand::r(X86Reg::RAX);
+        }
+    }
+
+    // eax = eax / divisor with the language's rules for 0 and -1
+    void genDivide(X86Operand divisor, const ASTNode* divisorNode) {
+        int32_t constant;
+        bool isConstant = constantValue(divisorNode, constant);
+        if (isConstant && constant == 0) {
+            emit(X86Op::Jmp, X86Operand::label(divideByZero));
+            return;
+        }
+        if (isConstant && constant == -1) {
+            emit(X86Op::Neg, X86Operand::r(X86Reg::RAX));
+            return;
+        }
+        int negate = newLabel(), done = newLabel();
+        if (!isConstant) {
+            emit(X86Op::Cmp, divisor, X86Operand::imm(0));
+            emitJcc(X86Cond::E, divideByZero);
+            // INT_MIN / -1 traps in idiv but wraps in the language
+            emit(X86Op::Cmp, divisor, X86Operand::imm(-1));
+            emitJcc(X86Cond::E, negate);
+        }
+        emit(X86Op::Cdq);
+        emit(X86Op::Idiv, divisor);
+        if (!isConstant) {
+            emit(X86Op::Jmp, X86Operand::label(done));
+            bind(negate);
+            emit(X86Op::Neg, X86Operand::r(X86Reg::RAX));
+            bind(done);
+        }
+    }
+
+    // Leaves the expression's value in temp(depth)
+    void genExpression(ASTNode* node, int depth) {
+        X86Operand result = temp(depth);
+        X86Operand left, right, operand;
+
+        switch (node->kind) {
+            case NodeKind::Number:
+            case NodeKind::Char:
+                emit(X86Op::Mov, result, X86Operand::imm(node->literal));
+                return;
+
+            case NodeKind::Identifier:
+                emit(X86Op::Mov, result, variable(node));
+                return;
+
+            case NodeKind::Assignment:
+                genExpression(node->children[0], depth);
+                emit(X86Op::Mov, variable(node), result);
+                return;
+
+            case NodeKind::BinOp: {
+                bool divide = node->value == "/";
+                genOperands(node, depth, left, right, divide);
+                if (divide) {
+                    if (!left.is(X86Reg::RAX)) emit(X86Op::Mov, X86Operand::r(X86Reg::RAX), left);
+                    genDivide(right, node->children[1]);
+                    emit(X86Op::Mov, result, X86Operand::r(X86Reg::RAX));
+                    return;
+                }
+                X86Op op = node->value == "+" ? X86Op::Add : node->value == "-" ? X86Op::Sub : X86Op::Imul;
+                emit(op, left, right);
+                if (!left.is(result.reg)) emit(X86Op::Mov, result, left);
+                return;
+            }
+
+            case NodeKind::ComparisonOp:
+                genOperands(node, depth, left, right, false);
+                emit(X86Op::Cmp, left, right);
+                function.code.push_back({X86Op::Set, comparison(node->value), {}, {}});
+                emit(X86Op::MovzxAL, result);
+                return;
+
+            case NodeKind::UnaryOp:
+                genExpression(node->children[0], depth);
+                if (node->value == "-") {
+                    emit(X86Op::Neg, result);
+                } else {
+                    emit(X86Op::Cmp, result, X86Operand::imm(0));
+                    function.code.push_back({X86Op::Set, X86Cond::E, {}, {}});
+                    emit(X86Op::MovzxAL, result);
+                }
+                return;
+
+            case NodeKind::LogicalOp: {
+                int isFalse = newLabel(), done = newLabel();
+                genBranch(node, false, isFalse, depth);
+                emit(X86Op::Mov, result, X86Operand::imm(1));
+                emit(X86Op::Jmp, X86Operand::label(done));
+                bind(isFalse);
+                emit(X86Op::Mov, result, X86Operand::imm(0));
+                bind(done);
+                return;
+            }
+
+            default:
+                // STRING values only fail once they are actually evaluated
+                emit(X86Op::Jmp, X86Operand::label(stringValue));
+                return;
+        }
+    }
+
+    // Jumps to label when the condition's truth equals jumpWhen
+    void genBranch(ASTNode* node, bool jumpWhen, int label, int depth) {
+        int32_t value;
+        if (constantValue(node, value)) {
+            if ((value != 0) == jumpWhen) emit(X86Op::Jmp, X86Operand::label(label));
+            return;
+        }
+        if (node->kind == NodeKind::UnaryOp && node->value == "!") {
+            genBranch(node->children[0], !jumpWhen, label, depth);
+            return;
+        }
+        if (node->kind == NodeKind::LogicalOp) {
+            bool decidesOn = node->value != "&&";
+            if (jumpWhen == decidesOn) {
+                genBranch(node->children[0], jumpWhen, label, depth);
+                genBranch(node->children[1], jumpWhen, label, depth);
+            } else {
+                int skip = newLabel();
+                genBranch(node->children[0], decidesOn, skip, depth);
+                genBranch(node->children[1], jumpWhen, label, depth);
+                bind(skip);
+            }
+            return;
+        }
+        X86Cond cond = X86Cond::NE;
+        X86Operand left, right;
+        if (node->kind == NodeKind::ComparisonOp) {
+            cond = comparison(node->value);
+            if (node->children[0]->kind == NodeKind::Identifier && simpleOperand(node->children[1], right)) {
+                // Compare a variable in place
+                left = variable(node->children[0]);
+            } else {
+                genOperands(node, depth, left, right, false);
+            }
+        } else {
+            genExpression(node, depth);
+            left = temp(depth);
+            right = X86Operand::imm(0);
+        }
+        emit(X86Op::Cmp, left, right);
+        emitJcc(jumpWhen ? cond : invertCondition(cond), label);
+    }
+
+    // Stores the value of expression into target
+    void genStore(X86Operand target, ASTNode* value) {
+        X86Operand operand;
+        if (simpleOperand(value, operand)) {
+            emit(X86Op::Mov, target, operand);
+            return;
+        }
+        // target = target op simple, computed in place
+        if (value->kind == NodeKind::BinOp && value->value != "/" &&
+            value->children[0]->kind == NodeKind::Identifier && simpleOperand(value->children[1], operand)) {
+            X86Operand source = variable(value->children[0]);
+            if (source.kind == target.kind && source.value == target.value && source.reg == target.reg) {
+                X86Op op = value->value == "+" ? X86Op::Add : value->value == "-" ? X86Op::Sub : X86Op::Imul;
+                emit(op, target, operand);
+                return;
+            }
+        }
+        genExpression(value, 0);
+        emit(X86Op::Mov, target, temp(0));
+    }
+
+    void genStatement(ASTNode* node) {
+        switch (node->kind) {
+            case NodeKind::Block:
+                for (ASTNode* child : node->children) {
+                    genStatement(child);
+                }
+                break;
+
+            case NodeKind::DeclarationInt:
+            case NodeKind::DeclarationChar:
+                if (!node->isGlobal && static_cast<size_t>(node->slot) < function.localNames.size()) {
+                    function.localNames[node->slot] = node->value;
+                }
+                // Uninitialized variables start out as zero on every entry
+                if (node->children.empty()) {
+                    emit(X86Op::Mov, variable(node), X86Operand::imm(0));
+                } else {
+                    genStore(variable(node), node->children[0]);
+                }
+                break;
+
+            case NodeKind::Assignment:
+                genStore(variable(node), node->children[0]);
+                break;
+
+            case NodeKind::If: {
+                int elseBranch = newLabel(), done = newLabel();
+                genBranch(node->children[0], false, elseBranch, 0);
+                genStatement(node->children[1]);
+                if (node->children.size() > 2) {
+                    emit(X86Op::Jmp, X86Operand::label(done));
+                    bind(elseBranch);
+                    genStatement(node->children[2]);
+                } else {
+                    bind(elseBranch);
+                }
+                bind(done);
+                break;
+            }
+
+            case NodeKind::While:
+            case NodeKind::For:
+                genLoop(node, true);
+                break;
+
+            case NodeKind::Return:
+                if (node->children.empty()) {
+                    emit(X86Op::Mov, X86Operand::r(X86Reg::RAX), X86Operand::imm(0));
+                } else {
+                    genExpression(node->children[0], 0);
+                    emit(X86Op::Mov, X86Operand::r(X86Reg::RAX), temp(0));
+                }
+                if (inLoop) {
+                    // Tell the interpreter the function returned
+                    emit(X86Op::Mov64, X86Operand::r(X86Reg::RDX), X86Operand::mem(X86Reg::RBP, kX86StatusOffset));
+                    emit(X86Op::Mov, X86Operand::mem(X86Reg::RDX, 0), X86Operand::imm(kX86Returned));
+                }
+                emit(X86Op::Jmp, X86Operand::label(epilogue));
+                break;
+
+            default:
+                genExpression(node, 0);
+                break;
+        }
+    }
+
+    // The condition is tested at the bottom, so entering at the condition is
+    // the same as arriving over the back edge
+    void genLoop(ASTNode* node, bool withInit) {
+        int body = newLabel(), condition = newLabel();
+        bool isFor = node->kind == NodeKind::For;
+        if (isFor && withInit) genStatement(node->children[0]);
+        emit(X86Op::Jmp, X86Operand::label(condition));
+        bind(body);
+        genStatement(node->children[isFor ? 3 : 1]);
+        if (isFor) genStatement(node->children[2]);
+        bind(condition);
+        genBranch(node->children[isFor ? 1 : 0], true, body, 0);
+    }
+
+    void genTrap(int label, int32_t status) {
+        bind(label);
+        emit(X86Op::Mov64, X86Operand::r(X86Reg::RAX), X86Operand::mem(X86Reg::RBP, kX86StatusOffset));
+        emit(X86Op::Mov, X86Operand::mem(X86Reg::RAX, 0), X86Operand::imm(status));
+        emit(X86Op::Jmp, X86Operand::label(epilogue));
+    }
+
+    // Frame slots start out as zero, and a slot keeps its value between the
+    // scopes that share it. A declaration always stores before any other use,
+    // except in its own initializer (int x = x;), so only slots whose first
+    // mention in code order is a read need clearing on entry.
+    void zeroLocalsReadFirst() {
+        std::vector<char> seen(function.frameSize, 0);
+        std::vector<X86Instr> clears;
+        for (const X86Instr& instr : function.code) {
+            for (const X86Operand* operand : {&instr.b, &instr.a}) {
+                if (operand->kind != X86Operand::Kind::Local || seen[operand->value]) continue;
+                seen[operand->value] = 1;
+                bool writeOnly = instr.op == X86Op::Mov && operand == &instr.a;
+                if (!writeOnly) clears.push_back({X86Op::Mov, X86Cond::E, *operand, X86Operand::imm(0)});
+            }
+        }
+        function.code.insert(function.code.begin(), clears.begin(), clears.end());
+    }
+
+public:
+    // Emits the body of a FUNCTION between the prologue and epilogue; the
+    // allocator fills in the frame once it knows which locals spill. main
+    // also runs the global initializers first.
+    X86Function generate(ASTNode* program, ASTNode* target) {
+        function.name = target->value;
+        function.globalCount = program->frameSize;
+        function.frameSize = target->frameSize;
+        function.localNames.assign(function.frameSize, "");
+        epilogue = newLabel();
+        divideByZero = newLabel();
+        stringValue = newLabel();
+
+        for (ASTNode* child : program->children) {
+            bool global = child->kind == NodeKind::DeclarationInt || child->kind == NodeKind::DeclarationChar;
+            if (global && target->value == "main") {
+                genStatement(child);
+            }
+        }
+        if (target->children.size() > 1) {
+            genStatement(target->children[1]);
+        }
+        // Falling off the end returns 0
+        emit(X86Op::Mov, X86Operand::r(X86Reg::RAX), X86Operand::imm(0));
+        bind(epilogue);
+        genTrap(divideByZero, kX86DivideByZero);
+        genTrap(stringValue, kX86StringValue);
+        zeroLocalsReadFirst();
+        return function;
+    }
+
+    // Emits a WHILE or FOR loop of function `target` (without a FOR's init)
+    // as a function of its own. On entry it loads the frame slots the loop
+    // mentions from the interpreter's frame and jumps to the condition; when
+    // the loop ends it stores them back.
+    X86Function generateLoop(ASTNode* program, ASTNode* target, ASTNode* loop) {
+        function.name = target->value;
+        function.globalCount = program->frameSize;
+        function.frameSize = target->frameSize;
+        function.localNames.assign(function.frameSize, "");
+        epilogue = newLabel();
+        divideByZero = newLabel();
+        stringValue = newLabel();
+        inLoop = true;
+
+        genLoop(loop, false);
+        std::vector<char> mentioned(function.frameSize, 0);
+        for (const X86Instr& instr : function.code) {
+            for (const X86Operand* operand : {&instr.a, &instr.b}) {
+                if (operand->kind == X86Operand::Kind::Local) mentioned[operand->value] = 1;
+            }
+        }
+
+        X86Operand frame = X86Operand::r(X86Reg::RDX);
+        std::vector<X86Instr> loads = {{X86Op::Mov64, X86Cond::E, frame, X86Operand::mem(X86Reg::RBP, kX86FrameOffset)}};
+        emit(X86Op::Mov64, frame, X86Operand::mem(X86Reg::RBP, kX86FrameOffset));
+        for (int slot = 0; slot < function.frameSize; ++slot) {
+            if (!mentioned[slot]) continue;
+            loads.push_back({X86Op::Mov, X86Cond::E, X86Operand::local(slot), X86Operand::mem(X86Reg::RDX, 4 * slot)});
+            emit(X86Op::Mov, X86Operand::mem(X86Reg::RDX, 4 * slot), X86Operand::local(slot));
+        }
+        function.code.insert(function.code.begin(), loads.begin(), loads.end());
+        emit(X86Op::Mov, X86Operand::r(X86Reg::RAX), X86Operand::imm(0));
+        bind(epilogue);
+        genTrap(divideByZero, kX86DivideByZero);
+        genTrap(stringValue, kX86StringValue);
+        return function;
+    }
+};
+
+struct LiveInterval {
+    int slot;
+    int start;
+    int end;
+};
+
+// Live intervals of the locals over the linear instruction order: from the
+// first to the last mention, widened to cover every loop the interval
+// overlaps, since a value can flow around the back edge
+std::vector<LiveInterval> computeLiveIntervals(const X86Function& function) {
+    std::vector<LiveInterval> intervals(function.frameSize, {0, -1, -1});
+    std::vector<int> labelPosition(function.labelCount, -1);
+    for (size_t i = 0; i < function.code.size(); ++i) {
+        const X86Instr& instr = function.code[i];
+        if (instr.op == X86Op::Label) labelPosition[instr.a.value] = static_cast<int>(i);
+        for (const X86Operand* operand : {&instr.a, &instr.b}) {
+            if (operand->kind != X86Operand::Kind::Local) continue;
+            LiveInterval& interval = intervals[operand->value];
+            interval.slot = operand->value;
+            if (interval.start < 0) interval.start = static_cast<int>(i);
+            interval.end = static_cast<int>(i);
+        }
+    }
+
+    std::vector<std::pair<int, int>> loops;
+    for (size_t i = 0; i < function.code.size(); ++i) {
+        const X86Instr& instr = function.code[i];
+        if (instr.op == X86Op::Jmp || instr.op == X86Op::Jcc) {
+            int target = labelPosition[instr.a.value];
+            if (target >= 0 && target < static_cast<int>(i)) loops.push_back({target, static_cast<int>(i)});
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (LiveInterval& interval : intervals) {
+            if (interval.start < 0) continue;
+            for (const auto& [loopStart, loopEnd] : loops) {
+                if (interval.start <= loopEnd && interval.end >= loopStart &&
+                    (interval.start > loopStart || interval.end < loopEnd)) {
+                    interval.start = std::min(interval.start, loopStart);
+                    interval.end = std::max(interval.end, loopEnd);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    std::vector<LiveInterval> used;
+    for (const LiveInterval& interval : intervals) {
+        if (interval.start >= 0) used.push_back(interval);
+    }
+    return used;
+}
+
+// Linear-scan register allocation (Poletto and Sarkar) of the locals. When
+// no register is free, the interval that ends last is spilled to its stack
+// slot. Fills in function.localLocations.
+void allocateRegisters(X86Function& function) {
+    static const X86Reg pool[] = {X86Reg::R9, X86Reg::R10, X86Reg::R11, X86Reg::RBX,
+                                  X86Reg::R12, X86Reg::R13, X86Reg::R14};
+    std::vector<LiveInterval> intervals = computeLiveIntervals(function);
+    std::sort(intervals.begin(), intervals.end(), [](const LiveInterval& a, const LiveInterval& b) {
+        return a.start != b.start ? a.start < b.start : a.slot < b.slot;
+    });
+
+    function.localLocations.assign(function.frameSize, X86Operand());
+    std::vector<X86Reg> free(std::rbegin(pool), std::rend(pool)); // Taken from the back
+    std::vector<LiveInterval> active;                             // Sorted by end
+
+    auto activate = [&](const LiveInterval& interval, X86Reg reg) {
+        function.localLocations[interval.slot] = X86Operand::r(reg);
+        auto position = std::upper_bound(active.begin(), active.end(), interval,
+                                         [](const LiveInterval& a, const LiveInterval& b) { return a.end < b.end; });
+        active.insert(position, interval);
+    };
+
+    for (const LiveInterval& interval : intervals) {
+        while (!active.empty() && active.front().end < interval.start) {
+            free.push_back(function.localLocations[active.front().slot].reg);
+            active.erase(active.begin());
+        }
+        if (!free.empty()) {
+            X86Reg reg = free.back();
+            free.pop_back();
+            activate(interval, reg);
+            continue;
+        }
+        LiveInterval& last = active.back();
+        if (last.end > interval.end) {
+            X86Reg reg = function.localLocations[last.slot].reg;
+            function.localLocations[last.slot] = X86Operand::mem(X86Reg::RBP, x86LocalOffset(last.slot));
+            active.pop_back();
+            activate(interval, reg);
+        } else {
+            function.localLocations[interval.slot] = X86Operand::mem(X86Reg::RBP, x86LocalOffset(interval.slot));
+        }
+    }
+
+    for (X86Instr& instr : function.code) {
+        for (X86Operand* operand : {&instr.a, &instr.b}) {
+            if (operand->kind == X86Operand::Kind::Local) *operand = function.localLocations[operand->value];
+        }
+    }
+}
+
+// Rewrites instructions whose operand combination x86 cannot encode
+// (memory-to-memory, imul into memory), going through eax
+void legalize(X86Function& function) {
+    std::vector<X86Instr> legal;
+    X86Operand eax = X86Operand::r(X86Reg::RAX);
+    for (const X86Instr& instr : function.code) {
+        bool twoOperand = instr.op == X86Op::Mov || instr.op == X86Op::Add || instr.op == X86Op::Sub ||
+                          instr.op == X86Op::Cmp || instr.op == X86Op::Imul;
+        if (instr.op == X86Op::Imul && instr.a.isMem()) {
+            legal.push_back({X86Op::Mov, X86Cond::E, eax, instr.a});
+            legal.push_back({X86Op::Imul, X86Cond::E, eax, instr.b});
+            legal.push_back({X86Op::Mov, X86Cond::E, instr.a, eax});
+        } else if (twoOperand && instr.a.isMem() && instr.b.isMem()) {
+            legal.push_back({X86Op::Mov, X86Cond::E, eax, instr.b});
+            legal.push_back({instr.op, instr.cond, instr.a, eax});
+        } else if (instr.op == X86Op::Mov && instr.a.isReg() && instr.b.isReg() && instr.a.reg == instr.b.reg) {
+            continue;
+        } else {
+            legal.push_back(instr);
+        }
+    }
+    function.code = std::move(legal);
+}
+
+// Bytes below the saved registers: the status and frame pointers and the
+// spill slots, rounded so rsp stays 16-byte aligned
+int32_t x86FrameBytes(const X86Function& function) {
+    int32_t bytes = 16 + 4 * function.frameSize;
+    return (bytes + 8 + 15) / 16 * 16 - 8;
+}
+
+// Allocates registers for a generated body and wraps it in the prologue and
+// epilogue. Compiled loops take the interpreter's frame as a first argument.
+X86Function finishX86(X86Function body, bool loop) {
+    allocateRegisters(body);
+    legalize(body);
+
+    X86Function function = body;
+    function.code.clear();
+    auto emit = [&](X86Op op, X86Operand a = {}, X86Operand b = {}) { function.code.push_back({op, X86Cond::E, a, b}); };
+    auto r = X86Operand::r;
+    const X86Reg saved[] = {X86Reg::RBX, X86Reg::R12, X86Reg::R13, X86Reg::R14, X86Reg::R15};
+
+    emit(X86Op::Push, r(X86Reg::RBP));
+    emit(X86Op::Mov64, r(X86Reg::RBP), r(X86Reg::RSP));
+    for (X86Reg reg : saved) emit(X86Op::Push, r(reg));
+    emit(X86Op::Sub64, r(X86Reg::RSP), X86Operand::imm(x86FrameBytes(body)));
+    if (loop) {
+        emit(X86Op::Mov64, X86Operand::mem(X86Reg::RBP, kX86FrameOffset), r(X86Reg::RDI));
+        emit(X86Op::Mov64, r(X86Reg::R15), r(X86Reg::RSI));
+        emit(X86Op::Mov64, X86Operand::mem(X86Reg::RBP, kX86StatusOffset), r(X86Reg::RDX));
+    } else {
+        emit(X86Op::Mov64, r(X86Reg::R15), r(X86Reg::RDI));
+        emit(X86Op::Mov64, X86Operand::mem(X86Reg::RBP, kX86StatusOffset), r(X86Reg::RSI));
+    }
+
+    // The epilogue label is 0; its instructions follow it in place
+    for (const X86Instr& instr : body.code) {
+        function.code.push_back(instr);
+        if (instr.op == X86Op::Label && instr.a.value == 0) {
+            emit(X86Op::Mov64, r(X86Reg::RSP), r(X86Reg::RBP));
+            emit(X86Op::Sub64, r(X86Reg::RSP), X86Operand::imm(kX86SavedBytes));
+            for (int i = 4; i >= 0; --i) emit(X86Op::Pop, r(saved[i]));
+            emit(X86Op::Pop, r(X86Reg::RBP));
+            emit(X86Op::Ret);
+        }
+    }
+    return function;
+}
+
+// The full function for a FUNCTION node (main by default)
+X86Function compileX86(ASTNode* program, ASTNode* target = nullptr) {
+    X86CodeGen generator;
+    return finishX86(generator.generate(program, target ? target : findMainFunction(program)), false);
+}
+
+// A WHILE or FOR node of function target, compiled for on-stack replacement
+X86Function compileX86Loop(ASTNode* program, ASTNode* target, ASTNode* loop) {
+    X86CodeGen generator;
+    return finishX86(generator.generateLoop(program, target, loop), true);
+}
+
+#endif
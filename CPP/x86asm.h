@@ -0,0 +1,154 @@
+#ifndef X86ASM_H
+#define X86ASM_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include "process.h" // For the trap signals
+#include "x86.h"
+
+const char* x86RegName(X86Reg reg, bool wide) {
+    static const char* const names64[] = {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+                                          "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"};
+    static const char* const names32[] = {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+                                          "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"};
+    return wide ? names64[static_cast<int>(reg)] : names32[static_cast<int>(reg)];
+}
+
+const char* x86CondName(X86Cond cond) {
+    switch (cond) {
+        case X86Cond::E: return "e";
+        case X86Cond::NE: return "ne";
+        case X86Cond::L: return "l";
+        case X86Cond::GE: return "ge";
+        case X86Cond::LE: return "le";
+        case X86Cond::G: return "g";
+    }
+    return "?";
+}
+
+// GNU as Intel syntax for one operand
+std::string x86OperandText(const X86Operand& operand, bool wide) {
+    switch (operand.kind) {
+        case X86Operand::Kind::Reg:
+            return x86RegName(operand.reg, wide);
+        case X86Operand::Kind::Imm:
+            return std::to_string(operand.value);
+        case X86Operand::Kind::Mem: {
+            std::string text = std::string(wide ? "QWORD" : "DWORD") + " PTR [" + x86RegName(operand.reg, true);
+            if (operand.value > 0) text += "+" + std::to_string(operand.value);
+            if (operand.value < 0) text += std::to_string(operand.value);
+            return text + "]";
+        }
+        case X86Operand::Kind::Label:
+            return ".L" + std::to_string(operand.value);
+        case X86Operand::Kind::Local:
+            return "local" + std::to_string(operand.value);
+        default:
+            return "";
+    }
+}
+
+std::string x86InstrText(const X86Instr& instr) {
+    static const char* const mnemonics[] = {"", "mov", "add", "sub", "imul", "neg", "cmp", "set", "movzx",
+                                            "cdq", "idiv", "jmp", "j", "push", "pop", "mov", "sub", "ret"};
+    std::string name = mnemonics[static_cast<int>(instr.op)];
+    bool wide = instr.op == X86Op::Push || instr.op == X86Op::Pop || instr.op == X86Op::Mov64 || instr.op == X86Op::Sub64;
+    switch (instr.op) {
+        case X86Op::Label:
+            return x86OperandText(instr.a, false) + ":";
+        case X86Op::Set:
+            return "set" + std::string(x86CondName(instr.cond)) + " al";
+        case X86Op::MovzxAL:
+            return "movzx " + x86OperandText(instr.a, false) + ", al";
+        case X86Op::Jcc:
+            return "j" + std::string(x86CondName(instr.cond)) + " " + x86OperandText(instr.a, false);
+        case X86Op::Imul:
+            if (instr.b.isImm()) {
+                // Only the three-operand form takes an immediate
+                std::string reg = x86OperandText(instr.a, false);
+                return "imul " + reg + ", " + reg + ", " + x86OperandText(instr.b, false);
+            }
+            break;
+        default:
+            break;
+    }
+    std::string text = name;
+    if (instr.a.kind != X86Operand::Kind::None) text += " " + x86OperandText(instr.a, wide);
+    if (instr.b.kind != X86Operand::Kind::None) text += ", " + x86OperandText(instr.b, wide);
+    return text;
+}
+
+// Writes a complete assembly file: the compiled function as clp_main, and a
+// main that passes it the globals, turns a runtime error status into the
+// interpreter's message and the error's signal (see process.h), and
+// otherwise exits with main's value
+void printX86Assembly(const X86Function& function, std::ostream& out) {
+    out << "# Register allocation:\n";
+    for (size_t slot = 0; slot < function.localLocations.size(); ++slot) {
+        const X86Operand& location = function.localLocations[slot];
+        if (location.kind == X86Operand::Kind::None) continue;
+        std::string name = function.localNames[slot].empty() ? "slot" + std::to_string(slot) : function.localNames[slot];
+        out << "#   " << name << " -> " << x86OperandText(location, false)
+            << (location.isMem() ? " (spilled)" : "") << "\n";
+    }
+    out << "\t.intel_syntax noprefix\n";
+    out << "\t.text\n";
+    out << "\t.p2align 4\n";
+    out << "clp_main:\n";
+    for (const X86Instr& instr : function.code) {
+        if (instr.op == X86Op::Label) {
+            out << x86InstrText(instr) << "\n";
+        } else {
+            out << "\t" << x86InstrText(instr) << "\n";
+        }
+    }
+    out << "\n\t.globl main\n";
+    out << "\t.type main, @function\n";
+    out << "main:\n";
+    out << "\tlea rdi, [rip+clp_globals]\n";
+    out << "\tlea rsi, [rip+clp_status]\n";
+    out << "\tcall clp_main\n";
+    out << "\tmov edi, eax\n";
+    out << "\tmov ecx, DWORD PTR [rip+clp_status]\n";
+    out << "\ttest ecx, ecx\n";
+    out << "\tje .Lclp_exit\n";
+    out << "\tlea rsi, [rip+clp_divide_message]\n";
+    out << "\tmov edx, OFFSET clp_divide_length\n";
+    out << "\tmov ebx, " << kDivideByZeroSignal << "\n";
+    out << "\tcmp ecx, " << kX86DivideByZero << "\n";
+    out << "\tje .Lclp_report\n";
+    out << "\tlea rsi, [rip+clp_string_message]\n";
+    out << "\tmov edx, OFFSET clp_string_length\n";
+    out << "\tmov ebx, " << kStringValueSignal << "\n";
+    out << ".Lclp_report:\n";
+    out << "\tmov edi, 2\n";
+    out << "\tmov eax, 1\n"; // write
+    out << "\tsyscall\n";
+    out << "\tmov eax, 39\n"; // getpid
+    out << "\tsyscall\n";
+    out << "\tmov edi, eax\n";
+    out << "\tmov esi, ebx\n";
+    out << "\tmov eax, 62\n"; // kill
+    out << "\tsyscall\n";
+    out << "\tmov edi, 1\n";
+    out << ".Lclp_exit:\n";
+    out << "\tmov eax, 231\n"; // exit_group
+    out << "\tsyscall\n";
+    out << "\n\t.section .rodata\n";
+    out << "clp_divide_message:\n";
+    out << "\t.ascii \"Runtime Error: Division by zero\\n\"\n";
+    out << "\t.set clp_divide_length, . - clp_divide_message\n";
+    out << "clp_string_message:\n";
+    out << "\t.ascii \"Runtime Error: String values are not supported at runtime\\n\"\n";
+    out << "\t.set clp_string_length, . - clp_string_message\n";
+    out << "\n\t.bss\n";
+    out << "\t.p2align 4\n";
+    out << "clp_globals:\n";
+    out << "\t.zero " << 4 * std::max<int32_t>(function.globalCount, 1) << "\n";
+    out << "clp_status:\n";
+    out << "\t.zero 4\n";
+    out << "\t.section .note.GNU-stack,\"\",@progbits\n";
+}
+
+#endif
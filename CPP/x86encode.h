@@ -0,0 +1,154 @@
+#ifndef X86ENCODE_H
+#define X86ENCODE_H
+
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <vector>
+#include "x86.h"
+
+// Machine code for one function. Label offsets are kept for callers that
+// need to enter or describe the code at a label.
+struct X86Code {
+    std::vector<uint8_t> bytes;
+    std::vector<int32_t> labelOffsets; // -1 for labels that were never bound
+};
+
+// Encodes the machine instructions of x86.h. Every jump uses a 32-bit
+// displacement, so one pass plus patching is enough.
+class X86Encoder {
+private:
+    X86Code code;
+    std::vector<std::pair<size_t, int>> jumps; // rel32 position, label
+
+    void byte(uint8_t value) { code.bytes.push_back(value); }
+
+    void imm32(int32_t value) {
+        for (int i = 0; i < 4; ++i) byte(static_cast<uint8_t>(static_cast<uint32_t>(value) >> (8 * i)));
+    }
+
+    static bool fitsInt8(int32_t value) { return value >= -128 && value <= 127; }
+
+    static int number(X86Reg reg) { return static_cast<int>(reg); }
+
+    // REX prefix, opcode and ModRM (with SIB and displacement) for an
+    // instruction whose r/m operand is a register or [base + disp]
+    void emitRM(std::initializer_list<uint8_t> opcode, int reg, const X86Operand& rm, bool wide) {
+        int base = number(rm.reg);
+        uint8_t rex = 0x40 | (wide ? 8 : 0) | (reg & 8 ? 4 : 0) | (base & 8 ? 1 : 0);
+        if (rex != 0x40) byte(rex);
+        for (uint8_t value : opcode) byte(value);
+        if (rm.isReg()) {
+            byte(0xC0 | (reg & 7) << 3 | (base & 7));
+            return;
+        }
+        if (!rm.isMem()) {
+            throw std::runtime_error("Cannot encode operand");
+        }
+        int32_t displacement = rm.value;
+        int mod = displacement == 0 && (base & 7) != 5 ? 0 : fitsInt8(displacement) ? 1 : 2;
+        byte(mod << 6 | (reg & 7) << 3 | (base & 7));
+        if ((base & 7) == 4) byte(0x24); // rsp and r12 need a SIB byte
+        if (mod == 1) byte(static_cast<uint8_t>(displacement));
+        if (mod == 2) imm32(displacement);
+    }
+
+    // The ALU group: op r/m, reg / op reg, r/m / op r/m, imm
+    void emitArithmetic(uint8_t toRM, uint8_t fromRM, int extension, const X86Instr& instr, bool wide) {
+        if (instr.b.isImm()) {
+            bool shortForm = fitsInt8(instr.b.value);
+            emitRM({static_cast<uint8_t>(shortForm ? 0x83 : 0x81)}, extension, instr.a, wide);
+            if (shortForm) {
+                byte(static_cast<uint8_t>(instr.b.value));
+            } else {
+                imm32(instr.b.value);
+            }
+        } else if (instr.b.isReg()) {
+            emitRM({toRM}, number(instr.b.reg), instr.a, wide);
+        } else if (instr.a.isReg()) {
+            emitRM({fromRM}, number(instr.a.reg), instr.b, wide);
+        } else {
+            throw std::runtime_error("Cannot encode memory-to-memory instruction");
+        }
+    }
+
+    void emitMove(const X86Instr& instr, bool wide) {
+        if (instr.b.isImm() && instr.a.isReg() && !wide) {
+            int reg = number(instr.a.reg);
+            if (reg & 8) byte(0x41);
+            byte(0xB8 + (reg & 7));
+            imm32(instr.b.value);
+        } else if (instr.b.isImm()) {
+            emitRM({0xC7}, 0, instr.a, wide);
+            imm32(instr.b.value);
+        } else {
+            emitArithmetic(0x89, 0x8B, 0, instr, wide);
+        }
+    }
+
+    void emitJump(std::initializer_list<uint8_t> opcode, int label) {
+        for (uint8_t value : opcode) byte(value);
+        jumps.push_back({code.bytes.size(), label});
+        imm32(0);
+    }
+
+    void emitPushPop(uint8_t opcode, X86Reg reg) {
+        if (number(reg) & 8) byte(0x41);
+        byte(opcode + (number(reg) & 7));
+    }
+
+public:
+    X86Code encode(const X86Function& function) {
+        code.labelOffsets.assign(function.labelCount, -1);
+        for (const X86Instr& instr : function.code) {
+            uint8_t cc = static_cast<uint8_t>(instr.cond);
+            switch (instr.op) {
+                case X86Op::Label: code.labelOffsets[instr.a.value] = static_cast<int32_t>(code.bytes.size()); break;
+                case X86Op::Mov: emitMove(instr, false); break;
+                case X86Op::Add: emitArithmetic(0x01, 0x03, 0, instr, false); break;
+                case X86Op::Sub: emitArithmetic(0x29, 0x2B, 5, instr, false); break;
+                case X86Op::Cmp: emitArithmetic(0x39, 0x3B, 7, instr, false); break;
+                case X86Op::Imul:
+                    if (instr.b.isImm()) {
+                        bool shortForm = fitsInt8(instr.b.value);
+                        emitRM({static_cast<uint8_t>(shortForm ? 0x6B : 0x69)}, number(instr.a.reg), instr.a, false);
+                        if (shortForm) {
+                            byte(static_cast<uint8_t>(instr.b.value));
+                        } else {
+                            imm32(instr.b.value);
+                        }
+                    } else {
+                        emitRM({0x0F, 0xAF}, number(instr.a.reg), instr.b, false);
+                    }
+                    break;
+                case X86Op::Neg: emitRM({0xF7}, 3, instr.a, false); break;
+                case X86Op::Idiv: emitRM({0xF7}, 7, instr.a, false); break;
+                case X86Op::Cdq: byte(0x99); break;
+                case X86Op::Set: emitRM({0x0F, static_cast<uint8_t>(0x90 + cc)}, 0, X86Operand::r(X86Reg::RAX), false); break;
+                case X86Op::MovzxAL: emitRM({0x0F, 0xB6}, number(instr.a.reg), X86Operand::r(X86Reg::RAX), false); break;
+                case X86Op::Jmp: emitJump({0xE9}, instr.a.value); break;
+                case X86Op::Jcc: emitJump({0x0F, static_cast<uint8_t>(0x80 + cc)}, instr.a.value); break;
+                case X86Op::Push: emitPushPop(0x50, instr.a.reg); break;
+                case X86Op::Pop: emitPushPop(0x58, instr.a.reg); break;
+                case X86Op::Mov64: emitMove(instr, true); break;
+                case X86Op::Sub64: emitArithmetic(0x29, 0x2B, 5, instr, true); break;
+                case X86Op::Ret: byte(0xC3); break;
+            }
+        }
+        for (const auto& [position, label] : jumps) {
+            int32_t target = code.labelOffsets[label];
+            int32_t displacement = target - static_cast<int32_t>(position + 4);
+            for (int i = 0; i < 4; ++i) {
+                code.bytes[position + i] = static_cast<uint8_t>(static_cast<uint32_t>(displacement) >> (8 * i));
+            }
+        }
+        return code;
+    }
+};
+
+X86Code encodeX86(const X86Function& function) {
+    X86Encoder encoder;
+    return encoder.encode(function);
+}
+
+#endif